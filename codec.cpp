@@ -0,0 +1,673 @@
+#include "codec.h"
+#include "stream.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace Converter3D
+{
+	namespace
+	{
+		// deflate length and distance codes (RFC 1951, 3.2.5)
+		const uint16_t LengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const uint8_t LengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const uint16_t DistanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const uint8_t DistanceExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		const size_t LengthCodes = sizeof(LengthBase) / sizeof(LengthBase[0]);
+		const size_t DistanceCodes = sizeof(DistanceBase) / sizeof(DistanceBase[0]);
+
+		uint32_t Reverse(uint32_t code, unsigned length)
+		{
+			uint32_t result = 0;
+			while (length--)
+			{
+				result = (result << 1) | (code & 1);
+				code >>= 1;
+			}
+			return result;
+		}
+	}
+
+	uint32_t Crc32(uint32_t crc, const void* data, size_t size)
+	{
+		static const auto table = []
+		{
+			std::array<uint32_t, 256> table;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			return table;
+		}();
+
+		auto bytes = static_cast<const uint8_t*>(data);
+
+		crc = ~crc;
+		while (size--)
+			crc = table[(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	bool HuffmanTable::Build(const uint8_t* lengths, size_t number)
+	{
+		std::fill(std::begin(counts), std::end(counts), 0);
+		for (size_t i = 0; i < number; i++)
+			counts[lengths[i]]++;
+		counts[0] = 0;
+
+		int left = 1;
+		for (unsigned length = 1; length <= MaxBits; length++)
+		{
+			left = (left << 1) - counts[length];
+			if (left < 0)
+				return false;	// over-subscribed
+		}
+
+		uint16_t offsets[MaxBits + 2] = {};
+		for (unsigned length = 1; length <= MaxBits; length++)
+			offsets[length + 1] = offsets[length] + counts[length];
+
+		symbols.resize(number);
+		for (size_t i = 0; i < number; i++)
+			if (lengths[i])
+				symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+
+		// canonical codes are assigned in symbol order within each length
+		std::fill(std::begin(fast), std::end(fast), 0);
+
+		uint32_t code = 0;
+		size_t index = 0;
+		for (unsigned length = 1; length <= FastBits; length++)
+		{
+			for (unsigned i = 0; i < counts[length]; i++, code++)
+			{
+				const uint16_t entry = static_cast<uint16_t>(symbols[index++] << 4 | length);
+				for (uint32_t j = Reverse(code, length); j < (1u << FastBits); j += 1u << length)
+					fast[j] = entry;
+			}
+			code <<= 1;
+		}
+
+		return true;
+	}
+
+	int HuffmanTable::Decode(GzipInputStream& input) const
+	{
+		const uint32_t bits = input.Peek(MaxBits);
+
+		const uint16_t entry = fast[bits & ((1u << FastBits) - 1)];
+		if (entry)
+		{
+			input.Drop(entry & 15);
+			return entry >> 4;
+		}
+
+		int code = 0, first = 0, index = 0;
+		for (unsigned length = 1; length <= MaxBits; length++)
+		{
+			code |= (bits >> (length - 1)) & 1;
+
+			const int count = counts[length];
+			if (code - count < first)
+			{
+				input.Drop(length);
+				return symbols[index + (code - first)];
+			}
+
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+
+		return -1;
+	}
+
+	GzipInputStream::GzipInputStream(std::unique_ptr<IInputStream> source) :
+		source(std::move(source)),
+		input(1 << 16),
+		window(WindowSize)
+	{
+	}
+
+	void GzipInputStream::Fill()
+	{
+		while (bit_count <= 56)
+		{
+			if (input_position == input_end && !overrun)
+			{
+				input_position = 0;
+				input_end = source->Read(input.data(), input.size());
+			}
+
+			if (input_position == input_end)
+			{
+				overrun++;	// pad with zeros, reading them is detected in Drop
+				bit_count += 8;
+				continue;
+			}
+
+			bit_buffer |= static_cast<uint64_t>(input[input_position++]) << bit_count;
+			bit_count += 8;
+		}
+	}
+
+	uint32_t GzipInputStream::Peek(unsigned number)
+	{
+		if (bit_count < number)
+			Fill();
+		return static_cast<uint32_t>(bit_buffer & ((1ull << number) - 1));
+	}
+
+	void GzipInputStream::Drop(unsigned number)
+	{
+		bit_buffer >>= number;
+		bit_count -= number;
+
+		if (bit_count < overrun * 8 && error == Errors::Success)
+			error = source->GetError() != Errors::Success ? source->GetError() : Errors::CorruptedStream;	// truncated
+	}
+
+	uint32_t GzipInputStream::Bits(unsigned number)
+	{
+		const uint32_t value = Peek(number);
+		Drop(number);
+		return value;
+	}
+
+	void GzipInputStream::AlignToByte()
+	{
+		Drop(bit_count % 8);
+	}
+
+	bool GzipInputStream::AtEnd()
+	{
+		Fill();
+		return bit_count == overrun * 8;
+	}
+
+	bool GzipInputStream::ReadHeader()
+	{
+		enum { HeaderCrc = 2, Extra = 4, Name = 8, Comment = 16 };
+
+		if (Bits(8) != 0x1f || Bits(8) != 0x8b || Bits(8) != 8)
+			return false;	// not gzip or not deflate
+
+		const uint32_t flags = Bits(8);
+		Bits(32);	// modification time
+		Bits(16);	// extra flags, operating system
+
+		if (flags & Extra)
+			for (uint32_t length = Bits(16); length && error == Errors::Success; length--)
+				Bits(8);
+
+		if (flags & Name)
+			while (Bits(8) && error == Errors::Success);
+
+		if (flags & Comment)
+			while (Bits(8) && error == Errors::Success);
+
+		if (flags & HeaderCrc)
+			Bits(16);
+
+		crc = 0;
+		member = written;
+		state = State::BlockHeader;
+
+		return error == Errors::Success;
+	}
+
+	bool GzipInputStream::ReadBlockHeader()
+	{
+		last_block = Bits(1);
+
+		switch (Bits(2))
+		{
+		case 0:
+		{
+			AlignToByte();
+			const uint32_t length = Bits(16);
+			if (length != (~Bits(16) & 0xffff))
+				return false;
+
+			stored_length = length;
+			state = State::Stored;
+			break;
+		}
+
+		case 1:
+		{
+			uint8_t lengths[288 + 30];
+			std::fill(lengths, lengths + 144, 8);
+			std::fill(lengths + 144, lengths + 256, 9);
+			std::fill(lengths + 256, lengths + 280, 7);
+			std::fill(lengths + 280, lengths + 288, 8);
+			std::fill(lengths + 288, lengths + 288 + 30, 5);
+
+			literals.Build(lengths, 288);
+			distances.Build(lengths + 288, 30);
+
+			state = State::Huffman;
+			break;
+		}
+
+		case 2:
+			if (!ReadDynamicTables())
+				return false;
+
+			state = State::Huffman;
+			break;
+
+		default:
+			return false;
+		}
+
+		return error == Errors::Success;
+	}
+
+	bool GzipInputStream::ReadDynamicTables()
+	{
+		static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		const uint32_t literals_number = Bits(5) + 257;
+		const uint32_t distances_number = Bits(5) + 1;
+		const uint32_t codes_number = Bits(4) + 4;
+
+		if (literals_number > 286 || distances_number > 30)
+			return false;
+
+		uint8_t lengths[286 + 30] = {};
+		for (uint32_t i = 0; i < codes_number; i++)
+			lengths[order[i]] = static_cast<uint8_t>(Bits(3));
+
+		HuffmanTable codes;
+		if (!codes.Build(lengths, 19))
+			return false;
+
+		std::fill(lengths, lengths + 19, 0);
+
+		const uint32_t total = literals_number + distances_number;
+		for (uint32_t index = 0; index < total && error == Errors::Success;)
+		{
+			const int symbol = codes.Decode(*this);
+			if (symbol < 0)
+				return false;
+
+			if (symbol < 16)
+			{
+				lengths[index++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t repeated = 0;
+			uint32_t count;
+
+			if (symbol == 16)
+			{
+				if (!index)
+					return false;	// nothing to repeat
+				repeated = lengths[index - 1];
+				count = 3 + Bits(2);
+			}
+			else if (symbol == 17)
+				count = 3 + Bits(3);
+			else
+				count = 11 + Bits(7);
+
+			if (index + count > total)
+				return false;
+
+			std::fill(lengths + index, lengths + index + count, repeated);
+			index += count;
+		}
+
+		if (!lengths[256])
+			return false;	// no end of block code
+
+		return literals.Build(lengths, literals_number) && distances.Build(lengths + literals_number, distances_number);
+	}
+
+	bool GzipInputStream::ReadTrailer()
+	{
+		AlignToByte();
+
+		UpdateCrc();
+
+		if (Bits(32) != crc || Bits(32) != static_cast<uint32_t>(written - member))
+			return false;
+
+		state = AtEnd() ? State::End : State::Header;	// concatenated members
+
+		return error == Errors::Success;
+	}
+
+	void GzipInputStream::UpdateCrc()
+	{
+		while (checked < written)
+		{
+			const size_t position = checked & (WindowSize - 1);
+			const size_t number = static_cast<size_t>(std::min<uint64_t>(written - checked, WindowSize - position));
+
+			crc = Crc32(crc, window.data() + position, number);
+			checked += number;
+		}
+	}
+
+	bool GzipInputStream::Fail()
+	{
+		if (error == Errors::Success)
+			error = Errors::CorruptedStream;
+		state = State::End;
+		return false;
+	}
+
+	bool GzipInputStream::Inflate()
+	{
+		// keep the unread bytes and the 32K history inside the window
+		const size_t space = WindowSize / 2 - 258;
+		const uint64_t mask = WindowSize - 1;
+
+		while (state != State::End && written - read < space)
+		{
+			switch (state)
+			{
+			case State::Header:
+				if (!ReadHeader())
+					return Fail();
+				break;
+
+			case State::BlockHeader:
+				if (!ReadBlockHeader())
+					return Fail();
+				break;
+
+			case State::Stored:
+				while (stored_length && written - read < space)
+				{
+					window[written++ & mask] = static_cast<uint8_t>(Bits(8));
+					stored_length--;
+				}
+
+				if (!stored_length)
+					state = last_block ? State::Trailer : State::BlockHeader;
+				break;
+
+			case State::Huffman:
+				while (written - read < space)
+				{
+					const int symbol = literals.Decode(*this);
+
+					if (symbol < 256)
+					{
+						if (symbol < 0)
+							return Fail();
+						window[written++ & mask] = static_cast<uint8_t>(symbol);
+						continue;
+					}
+
+					if (symbol == 256)
+					{
+						state = last_block ? State::Trailer : State::BlockHeader;
+						break;
+					}
+
+					const size_t length_code = symbol - 257;
+					if (length_code >= LengthCodes)
+						return Fail();
+					const uint32_t length = LengthBase[length_code] + Bits(LengthExtra[length_code]);
+
+					const int distance_code = distances.Decode(*this);
+					if (distance_code < 0 || static_cast<size_t>(distance_code) >= DistanceCodes)
+						return Fail();
+					const uint32_t distance = DistanceBase[distance_code] + Bits(DistanceExtra[distance_code]);
+
+					if (distance > written - member || distance > WindowSize / 2)
+						return Fail();
+
+					for (uint32_t i = 0; i < length; i++, written++)
+						window[written & mask] = window[(written - distance) & mask];
+				}
+				break;
+
+			case State::Trailer:
+				if (!ReadTrailer())
+					return Fail();
+				break;
+
+			default:
+				break;
+			}
+
+			if (error != Errors::Success)
+				return Fail();
+		}
+
+		UpdateCrc();
+
+		return true;
+	}
+
+	size_t GzipInputStream::Read(void* buffer, size_t size)
+	{
+		size_t total = 0;
+
+		while (total < size)
+		{
+			if (read == written)
+			{
+				if (state == State::End || !Inflate() || read == written)
+					break;
+			}
+
+			const size_t position = read & (WindowSize - 1);
+			const size_t number = static_cast<size_t>(std::min<uint64_t>({ size - total, written - read, WindowSize - position }));
+
+			memcpy(static_cast<char*>(buffer) + total, window.data() + position, number);
+
+			total += number;
+			read += number;
+		}
+
+		return total;
+	}
+
+	Error GzipInputStream::GetError() const
+	{
+		return error;
+	}
+
+	GzipOutputStream::GzipOutputStream(std::unique_ptr<IOutputStream> sink) :
+		sink(std::move(sink)),
+		head(1 << HashBits),
+		previous(HistorySize + BlockSize)
+	{
+		data.reserve(HistorySize + BlockSize);
+		output.reserve(BlockSize);
+
+		const uint8_t header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };	// deflate, no flags, unknown OS
+		output.insert(output.end(), std::begin(header), std::end(header));
+	}
+
+	void GzipOutputStream::Bits(uint32_t value, unsigned number)
+	{
+		bit_buffer |= static_cast<uint64_t>(value) << bit_count;
+		bit_count += number;
+
+		while (bit_count >= 8)
+		{
+			output.push_back(static_cast<uint8_t>(bit_buffer));
+			bit_buffer >>= 8;
+			bit_count -= 8;
+		}
+	}
+
+	void GzipOutputStream::Literal(unsigned symbol)
+	{
+		// fixed Huffman codes (RFC 1951, 3.2.6)
+		if (symbol < 144)
+			Bits(Reverse(0x30 + symbol, 8), 8);
+		else if (symbol < 256)
+			Bits(Reverse(0x190 + symbol - 144, 9), 9);
+		else if (symbol < 280)
+			Bits(Reverse(symbol - 256, 7), 7);
+		else
+			Bits(Reverse(0xc0 + symbol - 280, 8), 8);
+	}
+
+	void GzipOutputStream::Match(unsigned length, unsigned distance)
+	{
+		size_t length_code = LengthCodes - 1;
+		while (LengthBase[length_code] > length)
+			length_code--;
+
+		size_t distance_code = DistanceCodes - 1;
+		while (DistanceBase[distance_code] > distance)
+			distance_code--;
+
+		Literal(static_cast<unsigned>(257 + length_code));
+		Bits(length - LengthBase[length_code], LengthExtra[length_code]);
+
+		Bits(Reverse(static_cast<uint32_t>(distance_code), 5), 5);
+		Bits(distance - DistanceBase[distance_code], DistanceExtra[distance_code]);
+	}
+
+	void GzipOutputStream::Insert(size_t position)
+	{
+		const uint32_t hash = ((data[position] << 10) ^ (data[position + 1] << 5) ^ data[position + 2]) & ((1 << HashBits) - 1);
+
+		previous[position] = head[hash];
+		head[hash] = static_cast<int32_t>(position);
+	}
+
+	void GzipOutputStream::Compress(bool last)
+	{
+		const size_t end = data.size();
+
+		std::fill(head.begin(), head.end(), -1);
+		for (size_t position = 0; position + 3 <= history; position++)
+			Insert(position);
+
+		Bits(last ? 1 : 0, 1);
+		Bits(1, 2);	// fixed Huffman codes
+
+		for (size_t position = history; position < end;)
+		{
+			const size_t max_length = std::min<size_t>(258, end - position);
+
+			size_t best_length = 0;
+			size_t best_distance = 0;
+
+			if (max_length >= 3)
+			{
+				const uint32_t hash = ((data[position] << 10) ^ (data[position + 1] << 5) ^ data[position + 2]) & ((1 << HashBits) - 1);
+
+				int32_t candidate = head[hash];
+				for (unsigned chain = MaxChain; candidate >= 0 && position - candidate <= HistorySize && chain; chain--)
+				{
+					if (data[candidate + best_length] == data[position + best_length])
+					{
+						size_t length = 0;
+						while (length < max_length && data[candidate + length] == data[position + length])
+							length++;
+
+						if (length > best_length)
+						{
+							best_length = length;
+							best_distance = position - candidate;
+
+							if (length == max_length)
+								break;
+						}
+					}
+
+					candidate = previous[candidate];
+				}
+			}
+
+			if (best_length >= 3)
+			{
+				Match(static_cast<unsigned>(best_length), static_cast<unsigned>(best_distance));
+
+				for (size_t i = 0; i < best_length; i++, position++)
+					if (position + 3 <= end)
+						Insert(position);
+			}
+			else
+			{
+				Literal(data[position]);
+
+				if (position + 3 <= end)
+					Insert(position);
+				position++;
+			}
+		}
+
+		Literal(256);	// end of block
+
+		// keep the tail as history for the next block
+		const size_t keep = std::min(HistorySize, data.size());
+		data.erase(data.begin(), data.end() - keep);
+		history = keep;
+
+		if (last)
+		{
+			Bits(0, (8 - bit_count % 8) % 8);
+
+			for (uint32_t value : { crc, size })
+				for (int i = 0; i < 4; i++)
+					output.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+
+		FlushOutput();
+	}
+
+	void GzipOutputStream::FlushOutput()
+	{
+		if (sink->Write(output.data(), output.size()) != output.size())
+			failed = true;
+		output.clear();
+	}
+
+	size_t GzipOutputStream::Write(const void* buffer, size_t length)
+	{
+		auto bytes = static_cast<const uint8_t*>(buffer);
+
+		crc = Crc32(crc, bytes, length);
+		size += static_cast<uint32_t>(length);
+
+		for (size_t left = length; left;)
+		{
+			const size_t number = std::min(left, history + BlockSize - data.size());
+			data.insert(data.end(), bytes, bytes + number);
+
+			bytes += number;
+			left -= number;
+
+			if (data.size() == history + BlockSize)
+				Compress(false);
+		}
+
+		return length;
+	}
+
+	Error GzipOutputStream::Finish()
+	{
+		Compress(true);
+
+		const Error error = sink->Finish();
+		return failed ? Errors::CannotOpenFile : error;
+	}
+
+	std::unique_ptr<IInputStream> GzipCodec::Decode(std::unique_ptr<IInputStream> stream)
+	{
+		return std::make_unique<GzipInputStream>(std::move(stream));
+	}
+
+	std::unique_ptr<IOutputStream> GzipCodec::Encode(std::unique_ptr<IOutputStream> stream)
+	{
+		return std::make_unique<GzipOutputStream>(std::move(stream));
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "interface.h"
+#include <cstdint>
+#include <vector>
+
+namespace Converter3D
+{
+	uint32_t Crc32(uint32_t crc, const void* data, size_t size);
+
+	class GzipInputStream;
+
+	// Canonical Huffman code for the deflate decoder: fast table for short codes, slow path for long ones.
+	class HuffmanTable
+	{
+		static constexpr unsigned FastBits = 10;
+		static constexpr unsigned MaxBits = 15;
+
+		uint16_t fast[1 << FastBits];	// symbol << 4 | length, 0 for codes longer than FastBits
+		uint16_t counts[MaxBits + 1];
+		std::vector<uint16_t> symbols;
+	public:
+		bool Build(const uint8_t* lengths, size_t number);
+
+		int Decode(GzipInputStream& input) const;	// -1 on invalid code
+	};
+
+	// Streaming gzip (RFC 1952) decoder, supports multiple members.
+	class GzipInputStream : public IInputStream
+	{
+		std::unique_ptr<IInputStream> source;
+		Error error = Errors::Success;
+
+		// input
+		std::vector<uint8_t> input;
+		size_t input_position = 0;
+		size_t input_end = 0;
+		uint64_t bit_buffer = 0;
+		unsigned bit_count = 0;
+		unsigned overrun = 0;	// zero bytes appended after the end of the source
+
+		// output window
+		static constexpr size_t WindowSize = 1 << 16;
+		std::vector<uint8_t> window;
+		uint64_t written = 0;
+		uint64_t read = 0;
+		uint64_t checked = 0;	// bytes already included in crc
+		uint64_t member = 0;	// first byte of the current member
+
+		// decoder state
+		enum class State { Header, BlockHeader, Stored, Huffman, Trailer, End } state = State::Header;
+		bool last_block = false;
+		size_t stored_length = 0;
+		HuffmanTable literals;
+		HuffmanTable distances;
+		uint32_t crc = 0;
+
+		void Fill();
+		uint32_t Peek(unsigned number);
+		void Drop(unsigned number);
+		uint32_t Bits(unsigned number);
+		void AlignToByte();
+		bool AtEnd();
+
+		bool ReadHeader();
+		bool ReadBlockHeader();
+		bool ReadDynamicTables();
+		bool ReadTrailer();
+		bool Inflate();
+		void UpdateCrc();
+
+		bool Fail();
+
+		friend class HuffmanTable;
+	public:
+		GzipInputStream(std::unique_ptr<IInputStream> source);
+
+		virtual size_t Read(void* buffer, size_t size) override;
+		virtual Error GetError() const override;
+	};
+
+	// Streaming gzip encoder: hash chain LZ77 with fixed Huffman codes, a good trade-off for text meshes.
+	class GzipOutputStream : public IOutputStream
+	{
+		std::unique_ptr<IOutputStream> sink;
+
+		static constexpr size_t HistorySize = 1 << 15;
+		static constexpr size_t BlockSize = 1 << 17;
+		static constexpr size_t HashBits = 15;
+		static constexpr unsigned MaxChain = 32;
+
+		std::vector<uint8_t> data;		// history followed by pending bytes
+		size_t history = 0;
+		std::vector<int32_t> head;
+		std::vector<int32_t> previous;
+
+		std::vector<uint8_t> output;
+		uint64_t bit_buffer = 0;
+		unsigned bit_count = 0;
+
+		uint32_t crc = 0;
+		uint32_t size = 0;
+		bool failed = false;
+
+		void Bits(uint32_t value, unsigned number);
+		void Literal(unsigned symbol);
+		void Match(unsigned length, unsigned distance);
+		void Insert(size_t position);
+		void Compress(bool last);
+		void FlushOutput();
+	public:
+		GzipOutputStream(std::unique_ptr<IOutputStream> sink);
+
+		virtual size_t Write(const void* data, size_t size) override;
+		virtual Error Finish() override;
+	};
+
+	class GzipCodec : public ICodec
+	{
+	public:
+		virtual std::unique_ptr<IInputStream> Decode(std::unique_ptr<IInputStream> stream) override;
+		virtual std::unique_ptr<IOutputStream> Encode(std::unique_ptr<IOutputStream> stream) override;
+	};
+}
@@ -0,0 +1,320 @@
+#include "compare.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace Converter3D
+{
+	namespace
+	{
+		// splitmix64 finalizer
+		uint64_t Mix(uint64_t x)
+		{
+			x ^= x >> 30;
+			x *= 0xbf58476d1ce4e5b9ull;
+			x ^= x >> 27;
+			x *= 0x94d049bb133111ebull;
+			x ^= x >> 31;
+			return x;
+		}
+
+		uint64_t HashVertex(const glm::vec3& v)
+		{
+			uint32_t bits[3];
+			for (int i = 0; i < 3; i++)
+			{
+				const float value = v[i] == 0.f ? 0.f : v[i];	// -0 and +0 are the same
+				memcpy(&bits[i], &value, sizeof(value));
+			}
+
+			return Mix(bits[0] | static_cast<uint64_t>(bits[1]) << 32) ^ Mix(bits[2] + 0x9e3779b97f4a7c15ull);
+		}
+
+		// the vertices are rotated to the lexicographically smallest order, so the orientation is kept and ties do not matter
+		uint64_t HashTriangle(uint64_t a, uint64_t b, uint64_t c)
+		{
+			const std::array<uint64_t, 3> rotation = std::min({ std::array<uint64_t, 3>{ a, b, c }, { b, c, a }, { c, a, b } });
+			return Mix(rotation[0] + Mix(rotation[1] + Mix(rotation[2])));
+		}
+
+		Float Length2(const glm::vec3& v)
+		{
+			return glm::dot(v, v);
+		}
+
+		// squared distance to the nearest point of the triangle (Ericson, Real-Time Collision Detection)
+		Float DistanceSquared(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+		{
+			const glm::vec3 ab = b - a;
+			const glm::vec3 ac = c - a;
+
+			const glm::vec3 ap = p - a;
+			const Float d1 = glm::dot(ab, ap);
+			const Float d2 = glm::dot(ac, ap);
+			if (d1 <= 0.f && d2 <= 0.f)
+				return Length2(ap);
+
+			const glm::vec3 bp = p - b;
+			const Float d3 = glm::dot(ab, bp);
+			const Float d4 = glm::dot(ac, bp);
+			if (d3 >= 0.f && d4 <= d3)
+				return Length2(bp);
+
+			const Float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+				return Length2(p - (a + ab * (d1 / (d1 - d3))));
+
+			const glm::vec3 cp = p - c;
+			const Float d5 = glm::dot(ab, cp);
+			const Float d6 = glm::dot(ac, cp);
+			if (d6 >= 0.f && d5 <= d6)
+				return Length2(cp);
+
+			const Float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+				return Length2(p - (a + ac * (d2 / (d2 - d6))));
+
+			const Float va = d3 * d6 - d5 * d4;
+			if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f)
+				return Length2(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+			const Float denominator = 1.f / (va + vb + vc);
+			return Length2(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+		}
+
+		// the largest distance from the used vertices and the triangle centers of the mesh to the surface in the tree
+		Float OneSidedHausdorff(const Mesh& mesh, const TriangleTree& tree)
+		{
+			auto& attribute = mesh.GetAttribute(Attribute::Position);
+			auto& faces = mesh.GetFaces();
+
+			if (!attribute || attribute->GetDimension() != 3 || !faces)
+				return 0.f;
+
+			std::vector<char> used(attribute->GetSize(), 0);
+			for (size_t f = 0; f < faces->GetSize(); f++)
+			{
+				auto& indices = faces->Get(f).Get(Attribute::Position);
+				if (indices.GetSize() > 2)
+					for (size_t i = 0; i < indices.GetSize(); i++)
+						used[indices.Get(i)] = 1;
+			}
+
+			std::vector<glm::vec3> samples;
+			for (size_t i = 0; i < used.size(); i++)
+				if (used[i])
+					samples.push_back(attrib3(*attribute, i));
+
+			Mesh::ForEachTriangle(mesh, [&samples](auto a, auto b, auto c) { samples.push_back((a + b + c) / 3.f); });
+
+			if (samples.empty())
+				return 0.f;
+
+			if (tree.IsEmpty())
+				return std::numeric_limits<Float>::max();
+
+			std::atomic<Float> result{ 0.f };
+
+			ParallelFor(samples.size(), [&](size_t begin, size_t end)
+				{
+					// a sample nearer than the current maximum cannot change it, so its search stops early
+					Float local = result.load();
+					for (size_t i = begin; i < end; i++)
+						local = std::max(local, tree.Distance(samples[i], local));
+
+					Float current = result.load();
+					while (local > current && !result.compare_exchange_weak(current, local));
+				});
+
+			return result.load();
+		}
+	}
+
+	TriangleTree::TriangleTree(const IMesh& mesh)
+	{
+		Mesh::ForEachTriangle(mesh, [this](auto a, auto b, auto c) { triangles.push_back({ a, b, c }); });
+
+		if (triangles.empty())
+			return;
+
+		const size_t LeafSize = 4;
+
+		std::vector<glm::vec3> centers(triangles.size());
+		std::vector<Uint> order(triangles.size());
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			centers[t] = (triangles[t][0] + triangles[t][1] + triangles[t][2]) / 3.f;
+			order[t] = static_cast<Uint>(t);
+		}
+
+		// median splits give at most 2n / LeafSize nodes
+		nodes.reserve(2 * (triangles.size() / LeafSize + 1));
+		nodes.push_back({ glm::vec3(0.f), glm::vec3(0.f), 0, static_cast<Uint>(triangles.size()) });
+
+		std::vector<size_t> pending = { 0 };	// nodes with the triangles not split yet
+		while (!pending.empty())
+		{
+			const size_t index = pending.back();
+			pending.pop_back();
+
+			const Uint first = nodes[index].first;
+			const Uint count = nodes[index].count;
+
+			glm::vec3 low(std::numeric_limits<Float>::max());
+			glm::vec3 high(-std::numeric_limits<Float>::max());
+			glm::vec3 center_low = low;
+			glm::vec3 center_high = high;
+
+			for (Uint i = first; i < first + count; i++)
+			{
+				auto& triangle = triangles[order[i]];
+				low = glm::min(low, glm::min(triangle[0], glm::min(triangle[1], triangle[2])));
+				high = glm::max(high, glm::max(triangle[0], glm::max(triangle[1], triangle[2])));
+				center_low = glm::min(center_low, centers[order[i]]);
+				center_high = glm::max(center_high, centers[order[i]]);
+			}
+
+			nodes[index].low = low;
+			nodes[index].high = high;
+
+			if (count <= LeafSize)
+				continue;
+
+			const glm::vec3 extent = center_high - center_low;
+			const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+			const Uint middle = first + count / 2;
+			std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + first + count,
+				[&centers, axis](Uint a, Uint b) { return centers[a][axis] < centers[b][axis]; });
+
+			const size_t children = nodes.size();
+			nodes[index].first = static_cast<Uint>(children);
+			nodes[index].count = 0;
+
+			nodes.push_back({ glm::vec3(0.f), glm::vec3(0.f), first, middle - first });
+			nodes.push_back({ glm::vec3(0.f), glm::vec3(0.f), middle, first + count - middle });
+
+			pending.push_back(children);
+			pending.push_back(children + 1);
+		}
+
+		std::vector<std::array<glm::vec3, 3>> sorted(triangles.size());
+		for (size_t i = 0; i < order.size(); i++)
+			sorted[i] = triangles[order[i]];
+		triangles.swap(sorted);
+	}
+
+	Float TriangleTree::Distance(const glm::vec3& p, Float limit) const
+	{
+		if (triangles.empty())
+			return std::numeric_limits<Float>::max();
+
+		// squared distance to the box of a node, 0 inside
+		auto box = [this, &p](Uint index)
+		{
+			const Node& node = nodes[index];
+			const glm::vec3 outside = glm::max(glm::max(node.low - p, p - node.high), glm::vec3(0.f));
+			return glm::dot(outside, outside);
+		};
+
+		Float nearest = std::numeric_limits<Float>::max();	// squared
+
+		// depth first, the nearer child is searched first, the nodes farther than the nearest triangle are skipped
+		std::pair<Uint, Float> stack[64];	// median splits are never deeper than log2 of the triangles number
+		size_t size = 0;
+		stack[size++] = { 0, box(0) };
+
+		while (size && nearest > limit * limit)
+		{
+			const auto [index, distance] = stack[--size];
+			if (distance >= nearest)
+				continue;
+
+			const Node& node = nodes[index];
+			if (node.count)
+			{
+				for (Uint i = node.first; i < node.first + node.count; i++)
+					nearest = std::min(nearest, DistanceSquared(p, triangles[i][0], triangles[i][1], triangles[i][2]));
+				continue;
+			}
+
+			std::pair<Uint, Float> children[] = { { node.first, box(node.first) }, { node.first + 1, box(node.first + 1) } };
+			if (children[0].second < children[1].second)
+				std::swap(children[0], children[1]);
+
+			for (auto& child : children)
+				if (child.second < nearest)
+					stack[size++] = child;
+		}
+
+		return std::sqrt(nearest);
+	}
+
+	uint64_t Hash(const IMesh& mesh)
+	{
+		auto& attribute = mesh.GetAttribute(Attribute::Position);
+		auto& faces = mesh.GetFaces();
+
+		if (!attribute || attribute->GetDimension() != 3 || !faces)
+			return 0;
+
+		std::atomic<uint64_t> sum{ 0 };
+		std::atomic<uint64_t> number{ 0 };
+
+		// the sum of the triangle hashes does not depend on the order
+		ParallelFor(faces->GetSize(), [&](size_t begin, size_t end)
+			{
+				uint64_t local_sum = 0;
+				uint64_t local_number = 0;
+
+				for (size_t f = begin; f < end; f++)
+				{
+					auto& indices = faces->Get(f).Get(Attribute::Position);
+					if (indices.GetSize() < 3)
+						continue;
+
+					const uint64_t a = HashVertex(attrib3(*attribute, indices.Get(0)));
+					uint64_t b = HashVertex(attrib3(*attribute, indices.Get(1)));
+
+					for (size_t i = 2; i < indices.GetSize(); i++)
+					{
+						const uint64_t c = HashVertex(attrib3(*attribute, indices.Get(i)));
+						local_sum += HashTriangle(a, b, c);
+						local_number++;
+						b = c;
+					}
+				}
+
+				sum += local_sum;
+				number += local_number;
+			});
+
+		return Mix(sum.load() ^ Mix(number.load()));
+	}
+
+	MeshDifference Compare(const Mesh& a, const Mesh& b)
+	{
+		MeshDifference difference = {};
+
+		const Mesh* meshes[] = { &a, &b };
+		for (int i = 0; i < 2; i++)
+		{
+			difference.hashes[i] = Hash(*meshes[i]);
+			difference.triangles[i] = Mesh::CountTriangles(*meshes[i]);
+			difference.areas[i] = meshes[i]->Area();
+			difference.volumes[i] = meshes[i]->Volume();
+		}
+
+		// the same triangles, the distances are not measured
+		if (difference.hashes[0] == difference.hashes[1] && difference.triangles[0] == difference.triangles[1])
+			return difference;
+
+		const TriangleTree tree_a(a);
+		const TriangleTree tree_b(b);
+
+		difference.hausdorff = std::max(OneSidedHausdorff(a, tree_b), OneSidedHausdorff(b, tree_a));
+
+		return difference;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "general.h"
+#include <array>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Converter3D
+{
+	// Bounding volume hierarchy of the triangles of a mesh for nearest surface point queries.
+	// Nodes are split at the median center along the longest side, so the cost of a query does not grow
+	// with the distance to the surface like the rings of a uniform grid do.
+	class TriangleTree
+	{
+		struct Node
+		{
+			glm::vec3 low;
+			glm::vec3 high;
+			Uint first;		// the first triangle of a leaf or the first of the two adjacent children
+			Uint count;		// triangles of a leaf, 0 for an inner node
+		};
+
+		std::vector<std::array<glm::vec3, 3>> triangles;	// in the order of the leaves
+		std::vector<Node> nodes;	// the root is the first one
+	public:
+		TriangleTree(const IMesh& mesh);
+
+		bool IsEmpty() const { return triangles.empty(); }
+
+		// distance to the surface, the search stops as soon as a triangle is nearer than the limit
+		Float Distance(const glm::vec3& p, Float limit = 0.f) const;
+	};
+
+	// Result of comparing two meshes, the first values belong to the first mesh.
+	struct MeshDifference
+	{
+		uint64_t hashes[2];
+		size_t triangles[2];
+		Float areas[2];
+		Float volumes[2];
+		Float hausdorff;	// symmetric, sampled at the vertices and the centers of the triangles
+	};
+
+	// Geometric hash independent of the order of the faces, the vertex indexing and the first vertex of a triangle.
+	// Polygons and the same fan triangles written separately give the same hash, other triangulations do not; the orientation is kept.
+	uint64_t Hash(const IMesh& mesh);
+
+	MeshDifference Compare(const Mesh& a, const Mesh& b);
+}
@@ -1,8 +1,9 @@
 ﻿#include "converter.h"
 #include "general.h"
-#include "modifier.h"
+#include "outofcore.h"
+#include "stream.h"
+#include <algorithm>
 #include <array>
-#include <glm/gtc/constants.hpp>
 
 namespace Converter3D
 {
@@ -10,22 +11,148 @@ namespace Converter3D
 	char* gettoken(char** str, const char* delim)
 	{
 		char* token = *str + strspn(*str, delim);
-		*str = *str + strcspn(*str, delim);
+		*str = token + strcspn(token, delim);
 		if (**str)
 			*(*str)++ = 0;
 		return token;
 	}
 
-	// file helper - automatically closes the file
-	class File
+	namespace
 	{
-		FILE* stream;
-	public:
-		File(const char* name, const char* mode) : stream(nullptr) { fopen_s(&stream, name, mode); }
-		~File() { if (stream)fclose(stream); }
+		enum class Record
+		{
+			Other,
+			Position,
+			Texture,
+			Normal,
+			Face,
+		};
+
+		inline bool IsSpace(char c)
+		{
+			return c == ' ' || c == '\t';
+		}
+
+		// calls func(begin, end) for every line without the line ending and the comment until func returns false
+		template<class Func>
+		void ForEachLine(const char* begin, const char* end, Func func)
+		{
+			while (begin < end)
+			{
+				const char* last = static_cast<const char*>(memchr(begin, '\n', end - begin));
+				const char* next = last ? last + 1 : end;
+				if (!last)
+					last = end;
+
+				if (last > begin && last[-1] == '\r')
+					last--;
+
+				const char* comment = static_cast<const char*>(memchr(begin, '#', last - begin));
+				if (!func(begin, comment ? comment : last))
+					return;
+
+				begin = next;
+			}
+		}
+
+		// the same keywords as the tokenizer gives, begin is moved after the keyword
+		Record Classify(const char*& begin, const char* end)
+		{
+			while (begin < end && IsSpace(*begin))
+				begin++;
+
+			const char* keyword = begin;
+			while (begin < end && !IsSpace(*begin))
+				begin++;
+
+			if (begin - keyword == 1 && keyword[0] == 'v')
+				return Record::Position;
+			if (begin - keyword == 1 && keyword[0] == 'f')
+				return Record::Face;
+			if (begin - keyword == 2 && keyword[0] == 'v' && keyword[1] == 't')
+				return Record::Texture;
+			if (begin - keyword == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+				return Record::Normal;
+
+			return Record::Other;
+		}
+
+		// the same rules as ObjImporter::ReadIndices: up to 3 parts between slashes, a vertex without any index ends the face
+		Error ScanFace(const char* begin, const char* end, size_t& vertices, unsigned& face_format)
+		{
+			vertices = 0;
+			face_format = 0;
+
+			for (;;)
+			{
+				while (begin < end && IsSpace(*begin))
+					begin++;
+
+				unsigned format = 0;
+				for (size_t part = 0; begin < end && !IsSpace(*begin); begin++)
+				{
+					if (*begin == '/')
+						part++;
+					else if (part < 3)
+						format |= 1 << part;
+				}
+
+				if (!format)
+					break;
+
+				if (!face_format)
+					face_format = format;
+				else if (face_format != format)
+					return Errors::WrongFileFormat;	// not consistent face format
+
+				vertices++;
+			}
+
+			return vertices < 3 ? Errors::WrongFileFormat : Errors::Success;	// not enough vertices
+		}
+
+		// 3d modelling tools usually rotate obj files by 90 degrees around x, so we will do the same;
+		// the rotation is an exact permutation, a float matrix would change the coordinates of every conversion
+		glm::vec3 FromObj(const Float* v)
+		{
+			return glm::vec3(v[0], -v[2], v[1]);
+		}
+
+		glm::vec3 ToObj(const Float* v)
+		{
+			return glm::vec3(v[0], v[2], -v[1]);
+		}
+
+		void SetMesh(IMesh* mesh, const std::shared_ptr<AttributeBuffer<Float>>* attributes, const std::shared_ptr<FaceBuffer<Uint>>& faces)
+		{
+			// a face without normal indices would use its position indices, so normals are kept only if all the faces have them
+			auto& normals = attributes[static_cast<size_t>(Attribute::Normal)];
+			if (normals->GetSize() && std::any_of(faces->begin(), faces->end(), [](auto& face) { return face[static_cast<size_t>(Attribute::Normal)].empty(); }))
+			{
+				normals->clear();
+				for (auto& face : *faces)
+					std::vector<Uint>().swap(face[static_cast<size_t>(Attribute::Normal)]);
+			}
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (attributes[i]->GetSize())
+					mesh->SetAttribute(static_cast<Attribute>(i), attributes[i]);
+			}
+			mesh->SetFaces(faces);
 
-		operator FILE*() const { return stream; }
-	};
+			for (auto attribute : { Attribute::Position, Attribute::Normal })
+			{
+				auto& buffer = *attributes[static_cast<size_t>(attribute)];
+				for (size_t i = 0; i + 3 <= buffer.size(); i += 3)
+				{
+					const glm::vec3 v = FromObj(buffer.data() + i);
+					buffer[i + 1] = v.y;
+					buffer[i + 2] = v.z;
+				}
+			}
+		}
+	}
 
 	void ObjImporter::ReadFloats(char** data, std::vector<Float>& floats, size_t number)
 	{
@@ -36,31 +163,85 @@ namespace Converter3D
 		}
 	}
 
+	void ObjImporter::ReadFloats(char** data, Float* floats, size_t number)
+	{
+		while (number--)
+		{
+			char* token = gettoken(data, " \t");
+			*floats++ = token ? static_cast<float>(atof(token)) : 0.f;
+		}
+	}
+
 	unsigned ObjImporter::ReadIndices(char** data, int* indices, size_t number)
 	{
 		unsigned result = 0;
 
 		char* token = gettoken(data, " \t");
 
+		// empty parts keep their places, e.g. "1//3" has a position and a normal
 		for (size_t i = 0; *token && i < number; i++)
 		{
-			char* index = gettoken(&token, "/");
-			if (*index)
+			char* slash = strchr(token, '/');
+			if (slash)
+				*slash = 0;
+
+			if (*token)
 			{
 				result |= 1 << i;
-				indices[i] = atoi(index);
+				indices[i] = atoi(token);
 			}
+
+			if (!slash)
+				break;
+			token = slash + 1;
 		}
 
 		return result;
 	}
 
-	Error ObjImporter::Import(IMesh* mesh, std::string path)
+	template<class Func>
+	Error ObjImporter::ReadFace(char** data, const size_t* counts, unsigned& face_format, Func add)
 	{
-		File file(path.c_str(), "rt");
+		face_format = 0;
+		size_t vertices = 0;
+
+		std::array<int, 3> offset = { 0, 0, 0 };
+
+		while (unsigned format = ReadIndices(data, offset.data(), offset.size()))
+		{
+			if (!face_format)
+				face_format = format;
+			else if (face_format != format)
+				return Errors::WrongFileFormat;	// not consistent face format
+
+			Uint indices[3] = { 0, 0, 0 };
+			for (size_t i = 0; i < offset.size(); i++)
+			{
+				if (!(format & (1 << i)))
+					continue;
+
+				if (!offset[i] || (offset[i] < 0 && static_cast<size_t>(-static_cast<int64_t>(offset[i])) > counts[i]))
+					return Errors::WrongFileFormat;	// no such record
+
+				indices[i] = offset[i] > 0 ? static_cast<Uint>(offset[i] - 1) : static_cast<Uint>(counts[i] + offset[i]);
+			}
+
+			if (!add(indices))
+				return Errors::WrongFileFormat;
+
+			vertices++;
+		}
+
+		return vertices < 3 ? Errors::WrongFileFormat : Errors::Success;	// not enough vertices
+	}
 
-		if (!file)
-			return Errors::CannotOpenFile;	// not found
+	Error ObjImporter::Import(IMesh* mesh, IInputStream* stream)
+	{
+		if (auto mapped = dynamic_cast<MappedInputStream*>(stream))
+		{
+			if (mapped->GetData())
+				return Import(mesh, mapped->GetData(), mapped->GetSize());
+		}
 
 		std::shared_ptr<AttributeBuffer<Float>> attributes[] =
 		{
@@ -71,10 +252,12 @@ namespace Converter3D
 
 		auto faces = std::make_shared<FaceBuffer<Uint>>();
 
-		std::vector<char> line(16 * 1024);	// we assume that no one has written very long comments/faces
-		while (fgets(line.data(), static_cast<int>(line.size()), file))
+		size_t limits[3] = { 0, 0, 0 };	// the greatest indices + 1, the records may follow the faces
+
+		LineReader reader(stream);
+		while (char* line = reader.GetLine())
 		{
-			char* data = line.data();	// raw pointers for fast parsing
+			char* data = line;	// raw pointers for fast parsing
 			char* comment = strchr(data, '#');
 			if (comment)
 				*comment = 0;	// deleting comments
@@ -89,83 +272,485 @@ namespace Converter3D
 				ReadFloats(&data, *attributes[static_cast<size_t>(Attribute::Texture)], 3);
 			else if (!strcmp(element, "f"))
 			{
-				unsigned face_format = 0;
-
-				std::string index;
 				Face<Uint>& face = faces->emplace_back(Face<Uint>());
 
-				std::array<int, 3> offset = { 0, 0, 0 };
+				const size_t counts[] = { attributes[0]->GetSize(), attributes[1]->GetSize(), attributes[2]->GetSize() };
+
+				unsigned face_format;
+				Error error = ReadFace(&data, counts, face_format, [&](const Uint* indices)
+					{
+						for (size_t i = 0; i < 3; i++)
+						{
+							if (face_format & (1 << i))
+							{
+								face[i].push_back(indices[i]);
+								limits[i] = std::max<size_t>(limits[i], indices[i] + size_t(1));
+							}
+						}
+						return true;
+					});
+
+				if (error != Errors::Success)
+					return error;
+			}
+		}
+
+		if (stream->GetError() != Errors::Success)
+			return stream->GetError();	// unreadable or corrupted input
+
+		for (size_t i = 0; i < 3; i++)
+			if (limits[i] > attributes[i]->GetSize())
+				return Errors::WrongFileFormat;	// index out of range
+
+		SetMesh(mesh, attributes, faces);
+
+		return Errors::Success;
+	}
+
+	Error ObjImporter::Scan(const char* data, size_t size, std::vector<Chunk>& chunks)
+	{
+		// several chunks per thread for balancing, but large enough to keep the threads busy
+		const size_t MinChunkSize = 1 << 20;
+		const size_t number = std::max<size_t>(1, std::min<size_t>(ThreadsNumber() * 4, size / MinChunkSize));
+
+		chunks.clear();
+
+		const char* end = data + size;
+		for (size_t i = 1; i <= number; i++)
+		{
+			const char* begin = chunks.empty() ? data : chunks.back().end;
+			const char* last = i == number ? end : data + size / number * i;
+			if (last <= begin)
+				continue;	// the previous chunk has already passed this border
+
+			if (last < end)
+			{
+				last = static_cast<const char*>(memchr(last, '\n', end - last));
+				last = last ? last + 1 : end;
+			}
 
-				unsigned format;
+			Chunk chunk = {};
+			chunk.begin = begin;
+			chunk.end = last;
+			chunks.push_back(chunk);
+		}
 
-				while (format = ReadIndices(&data, offset.data(), offset.size()))
+		ParallelFor(chunks.size(), [&chunks](size_t first, size_t last)
+			{
+				for (size_t c = first; c < last; c++)
 				{
-					if (!face_format)
-						face_format = format;
-					else if(face_format != format)
-						return Errors::WrongFileFormat;	// not consistent face format
-
-					for (size_t i = 0; i < offset.size(); i++)
-						if (face_format & (1 << i))
-							face[i].push_back(offset[i] > 0 ? static_cast<Uint>(offset[i] - 1) : static_cast<Uint>(attributes[i]->GetSize() + offset[i]));
+					Chunk& chunk = chunks[c];
+
+					ForEachLine(chunk.begin, chunk.end, [&chunk](const char* begin, const char* end)
+						{
+							size_t vertices;
+							unsigned format;
+
+							switch (Classify(begin, end))
+							{
+							case Record::Position:
+								chunk.counts[static_cast<size_t>(Attribute::Position)]++;
+								break;
+							case Record::Texture:
+								chunk.counts[static_cast<size_t>(Attribute::Texture)]++;
+								break;
+							case Record::Normal:
+								chunk.counts[static_cast<size_t>(Attribute::Normal)]++;
+								break;
+							case Record::Face:
+								chunk.error = ScanFace(begin, end, vertices, format);
+								chunk.faces++;
+								break;
+							default:
+								break;
+							}
+
+							return chunk.error == Errors::Success;
+						});
 				}
+			}, 1);
+
+		for (size_t c = 0; c < chunks.size(); c++)
+		{
+			if (chunks[c].error != Errors::Success)
+				return chunks[c].error;
 
-				if (face.GetSize() < 3)
-					return Errors::WrongFileFormat;	// not enough vertices
+			if (c)
+			{
+				for (size_t i = 0; i < 3; i++)
+					chunks[c].offsets[i] = chunks[c - 1].offsets[i] + chunks[c - 1].counts[i];
+				chunks[c].face_offset = chunks[c - 1].face_offset + chunks[c - 1].faces;
 			}
 		}
 
-		for (int i = 0; i < 3; i++)
+		return Errors::Success;
+	}
+
+	Error ObjImporter::Import(IMesh* mesh, const char* data, size_t size)
+	{
+		std::vector<Chunk> chunks;
+
+		Error error = Scan(data, size, chunks);
+		if (error != Errors::Success)
+			return error;	// rejected before anything is allocated
+
+		std::shared_ptr<AttributeBuffer<Float>> attributes[] =
+		{
+			std::make_shared<AttributeBuffer<Float>>(3),
+			std::make_shared<AttributeBuffer<Float>>(3),
+			std::make_shared<AttributeBuffer<Float>>(3),
+		};
+
+		auto faces = std::make_shared<FaceBuffer<Uint>>();
+
+		size_t totals[3] = { 0, 0, 0 };	// records of the whole file, the limits of the indices
+
+		if (!chunks.empty())
 		{
-			if (attributes[i]->GetSize())
-				mesh->SetAttribute(static_cast<Attribute>(i), attributes[i]);
+			const Chunk& last = chunks.back();
+
+			for (size_t i = 0; i < 3; i++)
+			{
+				totals[i] = last.offsets[i] + last.counts[i];
+				attributes[i]->resize(totals[i] * 3);
+			}
+			faces->resize(last.face_offset + last.faces);
 		}
-		mesh->SetFaces(faces);
 
-		auto rotation = TransformModifier();	// 3d modelling tools usually rotate obj files so we will do the same
-		rotation.Rotate(glm::half_pi<float>(), glm::vec3(1.f, 0.f, 0.f));
-		rotation.Modify(mesh);
+		ParallelFor(chunks.size(), [&](size_t first, size_t last)
+			{
+				std::vector<char> line;	// a copy for the tokenizer, the mapped file is read-only
+
+				for (size_t c = first; c < last; c++)
+				{
+					Chunk& chunk = chunks[c];
+
+					size_t counts[3] = { chunk.offsets[0], chunk.offsets[1], chunk.offsets[2] };	// records before the line
+					size_t face_index = chunk.face_offset;
+
+					ForEachLine(chunk.begin, chunk.end, [&](const char* begin, const char* end)
+						{
+							const Record record = Classify(begin, end);
+							if (record == Record::Other)
+								return true;
+
+							line.assign(begin, end);
+							line.push_back(0);
+							char* data = line.data();
+
+							if (record != Record::Face)
+							{
+								const size_t i = static_cast<size_t>(record == Record::Position ? Attribute::Position : record == Record::Texture ? Attribute::Texture : Attribute::Normal);
+								ReadFloats(&data, attributes[i]->data() + counts[i]++ * 3, 3);
+								return true;
+							}
+
+							Face<Uint>& face = (*faces)[face_index++];
+
+							// the index lists of a face are reserved by its constructor, larger polygons grow them
+							unsigned face_format;
+							chunk.error = ReadFace(&data, counts, face_format, [&](const Uint* indices)
+								{
+									for (size_t i = 0; i < 3; i++)
+									{
+										if (face_format & (1 << i))
+										{
+											if (indices[i] >= totals[i])
+												return false;	// index out of range
+
+											face[i].push_back(indices[i]);
+										}
+									}
+									return true;
+								});
+
+							return chunk.error == Errors::Success;
+						});
+				}
+			}, 1);
+
+		for (auto& chunk : chunks)
+		{
+			if (chunk.error != Errors::Success)
+				return chunk.error;
+		}
+
+		SetMesh(mesh, attributes, faces);
 
 		return Errors::Success;
 	}
 
-	Error StlExporter::Export(const IMesh* mesh, std::string path)
+	Error ObjImporter::Import(OutOfCoreMesh* mesh, IInputStream* stream)
 	{
-		auto attribute = mesh->GetAttribute(Attribute::Position);
-		auto faces = mesh->GetFaces();
+		size_t limit = 0;	// the greatest position index + 1
 
-		if (attribute && attribute->GetDimension() != 3)
+		LineReader reader(stream);
+		while (char* line = reader.GetLine())
+		{
+			char* data = line;
+			char* comment = strchr(data, '#');
+			if (comment)
+				*comment = 0;
+
+			char* element = gettoken(&data, " \t");
+
+			if (!strcmp(element, "v"))
+			{
+				Float position[3];
+				ReadFloats(&data, position, 3);
+				mesh->AddPosition(FromObj(position));	// the same rotation as for in-memory meshes, applied while reading
+			}
+			else if (!strcmp(element, "f"))
+			{
+				const size_t counts[] = { mesh->GetPositionsNumber(), 0, 0 };
+
+				Uint first = 0, previous = 0;
+				size_t face_size = 0;
+
+				unsigned face_format;
+				Error error = ReadFace(&data, counts, face_format, [&](const Uint* indices)
+					{
+						if (!(face_format & 1))
+							return false;	// no position index
+
+						if (!face_size)
+							first = indices[0];
+						else if (face_size >= 2)
+							mesh->AddTriangle(first, previous, indices[0]);	// fan triangulation
+
+						previous = indices[0];
+						face_size++;
+						limit = std::max<size_t>(limit, indices[0] + size_t(1));
+						return true;
+					});
+
+				if (error != Errors::Success)
+					return error;
+			}
+		}
+
+		if (stream->GetError() != Errors::Success)
+			return stream->GetError();
+
+		if (limit > mesh->GetPositionsNumber())
+			return Errors::WrongFileFormat;	// index out of range, checked before any pass reads the positions
+
+		return mesh->GetError();
+	}
+
+	Error ObjExporter::Export(const IMesh* mesh, IOutputStream* stream)
+	{
+		auto& positions = mesh->GetAttribute(Attribute::Position);
+		auto& faces = mesh->GetFaces();
+
+		if (!positions || positions->GetDimension() != 3 || !faces)
 			return Errors::WrongMeshFormat;	// unsuitable mesh format
 
-		File file(path.c_str(), "wb");	// C i/o is faster
-		if (!file)
-			return Errors::CannotOpenFile;	// cannot be opened for writing
+		const size_t BufferSize = 1 << 20;
+
+		std::vector<char> buffer;
+		buffer.reserve(BufferSize + 256);
+
+		auto flush = [&]()
+		{
+			if (buffer.size() >= BufferSize)
+			{
+				stream->Write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		};
+
+		// 9 digits restore the same floats
+		auto write_vector = [&](const char* element, const Float* values, size_t dimension)
+		{
+			char line[128];
+			int length = snprintf(line, sizeof(line), "%s", element);
+			for (size_t i = 0; i < dimension; i++)
+				length += snprintf(line + length, sizeof(line) - length, " %.9g", values[i]);
+			line[length++] = '\n';
+
+			buffer.insert(buffer.end(), line, line + length);
+			flush();
+		};
+
+		struct Element
+		{
+			Attribute attribute;
+			const char* name;
+			bool rotated;
+		};
+
+		const Element elements[] =
+		{
+			{ Attribute::Position, "v", true },
+			{ Attribute::Texture, "vt", false },
+			{ Attribute::Normal, "vn", true },
+		};
+
+		for (auto& element : elements)
+		{
+			auto& attribute = mesh->GetAttribute(element.attribute);
+			if (!attribute)
+				continue;
+
+			const size_t dimension = attribute->GetDimension();
+			if (element.rotated && dimension != 3)
+				return Errors::WrongMeshFormat;
 
-		uint32_t num_triangles = 0;
-		uint16_t zero_attribute = 0;
+			for (size_t i = 0; i < attribute->GetSize(); i++)
+			{
+				const Float* values = attribute->GetPointer() + i * dimension;
+				if (element.rotated)
+				{
+					const glm::vec3 rotated = ToObj(values);	// back to the obj axes
+					const Float xyz[] = { rotated.x, rotated.y, rotated.z };
+					write_vector(element.name, xyz, 3);
+				}
+				else
+					write_vector(element.name, values, dimension);
+			}
+		}
 
+		for (size_t f = 0; f < faces->GetSize(); f++)
+		{
+			auto& face = faces->Get(f);
+			const size_t face_size = face.GetSize();
+
+			// the attributes are written if every vertex of the face has them
+			const bool texture = mesh->GetAttribute(Attribute::Texture) && face.Get(Attribute::Texture).GetSize() == face_size;
+			const bool normal = mesh->GetAttribute(Attribute::Normal) && face.Get(Attribute::Normal).GetSize() == face_size;
+
+			buffer.push_back('f');
+			for (size_t i = 0; i < face_size; i++)
+			{
+				char vertex[48];
+				int length = snprintf(vertex, sizeof(vertex), " %u", face.Get(Attribute::Position).Get(i) + 1);
+
+				if (texture)
+					length += snprintf(vertex + length, sizeof(vertex) - length, "/%u", face.Get(Attribute::Texture).Get(i) + 1);
+				if (normal)
+					length += snprintf(vertex + length, sizeof(vertex) - length, texture ? "/%u" : "//%u", face.Get(Attribute::Normal).Get(i) + 1);
+
+				buffer.insert(buffer.end(), vertex, vertex + length);
+			}
+			buffer.push_back('\n');
+			flush();
+		}
+
+		stream->Write(buffer.data(), buffer.size());
+
+		return stream->Finish();
+	}
+
+	Error StlImporter::Import(IMesh* mesh, IInputStream* stream)
+	{
 		const size_t HeaderSize = 80;
+		const size_t TriangleSize = 12 * sizeof(float) + sizeof(uint16_t);
+
+		char header[HeaderSize + sizeof(uint32_t)];
+		if (stream->Read(header, sizeof(header)) != sizeof(header))
+			return stream->GetError() != Errors::Success ? stream->GetError() : Errors::WrongFileFormat;
 
-		fseek(file, HeaderSize + sizeof(num_triangles), SEEK_SET);	// skip header and triangles number
+		uint32_t number;
+		memcpy(&number, header + HeaderSize, sizeof(number));
 
-		Mesh::ForEachTriangle(*mesh, [&](auto a, auto b, auto c)
+		auto positions = std::make_shared<AttributeBuffer<Float>>(3);
+		auto faces = std::make_shared<FaceBuffer<Uint>>();
+
+		// the count of an ascii or truncated file can be anything, it is trusted only as far as the size is known
+		if (auto mapped = dynamic_cast<MappedInputStream*>(stream))
+		{
+			if (mapped->GetSize() < sizeof(header) + static_cast<size_t>(number) * TriangleSize)
+				return Errors::WrongFileFormat;	// ascii or truncated
+
+			positions->resize(static_cast<size_t>(number) * 9);
+			faces->resize(number);
+		}
+
+		std::vector<char> buffer(TriangleSize * 16 * 1024);	// read in large chunks like the exporter writes
+
+		for (size_t first = 0; first < number;)
+		{
+			const size_t count = std::min<size_t>(number - first, buffer.size() / TriangleSize);
+			if (stream->Read(buffer.data(), count * TriangleSize) != count * TriangleSize)
+				return stream->GetError() != Errors::Success ? stream->GetError() : Errors::WrongFileFormat;	// ascii or truncated
+
+			if (faces->size() < first + count)
+			{
+				positions->resize((first + count) * 9);	// compressed streams grow with the data read
+				faces->resize(first + count);
+			}
+
+			for (size_t t = 0; t < count; t++, first++)
+			{
+				memcpy(positions->data() + first * 9, buffer.data() + t * TriangleSize + 3 * sizeof(float), 9 * sizeof(float));	// the normal is skipped
+
+				auto& face = (*faces)[first][static_cast<size_t>(Attribute::Position)];
+				for (Uint i = 0; i < 3; i++)
+					face.push_back(static_cast<Uint>(first * 3) + i);
+			}
+		}
+
+		if (number)
+			mesh->SetAttribute(Attribute::Position, positions);
+		mesh->SetFaces(faces);
+
+		return Errors::Success;
+	}
+
+	Error StlExporter::Write(IOutputStream* stream, size_t num_triangles, const std::function<void(const Triangle&)>& for_each_triangle)
+	{
+		const uint32_t number = static_cast<uint32_t>(num_triangles);	// known in advance, streams cannot seek back
+		const uint16_t zero_attribute = 0;
+
+		const size_t HeaderSize = 80;
+		const size_t TriangleSize = 12 * sizeof(float) + sizeof(zero_attribute);
+
+		std::vector<char> buffer(HeaderSize + sizeof(number));
+		memcpy(buffer.data() + HeaderSize, &number, sizeof(number));
+
+		const size_t BufferSize = TriangleSize * 16 * 1024;	// write in large chunks, calls through the stream are not free
+		buffer.reserve(BufferSize);
+
+		for_each_triangle([&](auto a, auto b, auto c)
 			{
 				auto normal = glm::normalize(glm::cross(c - b, a - b));
 
-				fwrite(&normal, sizeof(float), 3, file);
-				fwrite(&a, sizeof(float), 3, file);
-				fwrite(&b, sizeof(float), 3, file);
-				fwrite(&c, sizeof(float), 3, file);
-				fwrite(&zero_attribute, sizeof(zero_attribute), 1, file);
+				const size_t offset = buffer.size();
+				buffer.resize(offset + TriangleSize);
 
-				num_triangles++;
+				char* triangle = buffer.data() + offset;
+				memcpy(triangle, &normal, 3 * sizeof(float));
+				memcpy(triangle + 3 * sizeof(float), &a, 3 * sizeof(float));
+				memcpy(triangle + 6 * sizeof(float), &b, 3 * sizeof(float));
+				memcpy(triangle + 9 * sizeof(float), &c, 3 * sizeof(float));
+				memcpy(triangle + 12 * sizeof(float), &zero_attribute, sizeof(zero_attribute));
+
+				if (buffer.size() + TriangleSize > BufferSize)
+				{
+					stream->Write(buffer.data(), buffer.size());
+					buffer.clear();
+				}
 			});
 
-		fseek(file, HeaderSize, SEEK_SET);	// write triangles number
-		fwrite(&num_triangles, sizeof(num_triangles), 1, file);
+		stream->Write(buffer.data(), buffer.size());
 
-		fclose(file);
+		return stream->Finish();
+	}
 
-		return Errors::Success;
+	Error StlExporter::Export(const IMesh* mesh, IOutputStream* stream)
+	{
+		auto& attribute = mesh->GetAttribute(Attribute::Position);
+
+		if (attribute && attribute->GetDimension() != 3)
+			return Errors::WrongMeshFormat;	// unsuitable mesh format
+
+		return Write(stream, Mesh::CountTriangles(*mesh), [mesh](const Triangle& func) { Mesh::ForEachTriangle(*mesh, func); });
+	}
+
+	Error StlExporter::Export(OutOfCoreMesh* mesh, IOutputStream* stream)
+	{
+		const Error error = Write(stream, mesh->GetTrianglesNumber(), [mesh](const Triangle& func) { mesh->ForEachTriangle(func); });
+		return mesh->GetError() != Errors::Success ? mesh->GetError() : error;
 	}
 }
@@ -1,21 +1,70 @@
 #pragma once
 
 #include "interface.h"
+#include <functional>
 #include <vector>
+#include <glm/glm.hpp>
 
 namespace Converter3D
 {
+	class OutOfCoreMesh;
+
 	class ObjImporter : public IImporter
 	{
+	public:
+		// Records of a part of a mapped file, a chunk starts after a line ending.
+		struct Chunk
+		{
+			const char* begin;
+			const char* end;
+			size_t counts[3];	// positions, texture coordinates and normals - in the attribute order
+			size_t faces;
+			size_t offsets[3];	// records of all previous chunks, also for the relative indices
+			size_t face_offset;
+			Error error;
+		};
+
+		// Counts the records of every chunk in parallel and validates the faces without parsing numbers.
+		static Error Scan(const char* data, size_t size, std::vector<Chunk>& chunks);
+	private:
 		static void ReadFloats(char** data, std::vector<Float>& floats, size_t number);
+		static void ReadFloats(char** data, Float* floats, size_t number);
 		static unsigned ReadIndices(char** data, int* indices, size_t number);
+
+		// Parses the vertices of a face for all import paths, counts are the records before the face for the relative indices.
+		// Calls add(indices) with the zero based indices of every vertex in the face format, add returns false to reject the face.
+		// Zero and relative indices before the first record are rejected here, the callers check the absolute ones against the totals.
+		template<class Func>
+		static Error ReadFace(char** data, const size_t* counts, unsigned& face_format, Func add);
 	public:
-		virtual Error Import(IMesh* mesh, std::string path) override;
+		virtual Error Import(IMesh* mesh, IInputStream* stream) override;
+
+		Error Import(OutOfCoreMesh* mesh, IInputStream* stream);	// positions only, faces are triangulated
+		Error Import(IMesh* mesh, const char* data, size_t size);	// buffers are allocated by the scan, the chunks are parsed in parallel
+	};
+
+	// Positions, texture coordinates and normals with the indexed faces, the import rotation is undone.
+	class ObjExporter : public IExporter
+	{
+	public:
+		virtual Error Export(const IMesh* mesh, IOutputStream* stream) override;
+	};
+
+	// Binary STL, every triangle has its own vertices.
+	class StlImporter : public IImporter
+	{
+	public:
+		virtual Error Import(IMesh* mesh, IInputStream* stream) override;
 	};
 
 	class StlExporter : public IExporter
 	{
+		using Triangle = std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)>;
+
+		static Error Write(IOutputStream* stream, size_t num_triangles, const std::function<void(const Triangle&)>& for_each_triangle);
 	public:
-		virtual Error Export(const IMesh* mesh, std::string path) override;
+		virtual Error Export(const IMesh* mesh, IOutputStream* stream) override;
+
+		Error Export(OutOfCoreMesh* mesh, IOutputStream* stream);
 	};
 }
@@ -1,7 +1,56 @@
 ﻿#include "general.h"
+#include "stream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
 
 namespace Converter3D
 {
+	static unsigned threads_override = 0;
+
+	unsigned ThreadsNumber()
+	{
+		return threads_override ? threads_override : std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	void SetThreadsNumber(unsigned number)
+	{
+		threads_override = number;
+	}
+
+	void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& func, size_t grain)
+	{
+		const size_t threads_number = ThreadsNumber();
+
+		if (!grain)
+			grain = std::max<size_t>(1, count / (threads_number * 4));
+
+		std::atomic<size_t> next{ 0 };
+
+		auto worker = [&]
+		{
+			for (;;)
+			{
+				const size_t begin = next.fetch_add(grain);
+				if (begin >= count)
+					break;
+
+				func(begin, std::min(count, begin + grain));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < std::min(threads_number, (count + grain - 1) / grain); i++)
+			threads.emplace_back(worker);
+
+		worker();	// the calling thread works too
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
 	Float Mesh::Area() const
 	{
 		Float area = 0.f;
@@ -59,10 +108,58 @@ namespace Converter3D
 		return inside;
 	}
 
+	size_t Mesh::CountTriangles(const IMesh& mesh)
+	{
+		auto& attribute = mesh.GetAttribute(Attribute::Position);
+		auto& faces = mesh.GetFaces();
+
+		if (!attribute || attribute->GetDimension() != 3)
+			return 0;
+
+		size_t number = 0;
+
+		const auto faces_num = faces->GetSize();
+		for (size_t f = 0; f < faces_num; f++)
+		{
+			const auto face_size = faces->Get(f).GetSize();
+			if (face_size > 2)
+				number += face_size - 2;
+		}
+
+		return number;
+	}
+
+	std::shared_ptr<FaceBuffer<Uint>> Mesh::EditableFaces(IMesh& mesh)
+	{
+		auto& faces = mesh.GetFaces();
+		if (!faces)
+			return nullptr;
+
+		if (auto editable = std::dynamic_pointer_cast<FaceBuffer<Uint>>(faces))
+			return editable;
+
+		auto copy = std::make_shared<FaceBuffer<Uint>>();
+		copy->resize(faces->GetSize());
+
+		for (size_t f = 0; f < copy->size(); f++)
+			for (size_t a = 0; a < Face<Uint>::Lists; a++)
+			{
+				if (a && !mesh.GetAttribute(static_cast<Attribute>(a)))
+					continue;	// the positions stand in for the missing lists
+
+				auto& indices = faces->Get(f).Get(static_cast<Attribute>(a));
+				for (size_t i = 0; i < indices.GetSize(); i++)
+					(*copy)[f][a].push_back(indices.Get(i));
+			}
+
+		mesh.SetFaces(copy);
+		return copy;
+	}
+
 	void Mesh::ForEachTriangle(const IMesh& mesh, std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)> func)
 	{
-		auto attribute = mesh.GetAttribute(Attribute::Position);
-		auto faces = mesh.GetFaces();
+		auto& attribute = mesh.GetAttribute(Attribute::Position);
+		auto& faces = mesh.GetFaces();
 
 		if (!attribute || attribute->GetDimension() != 3)
 			return;
@@ -85,46 +182,150 @@ namespace Converter3D
 		}
 	}
 
-	std::string Manager::Extension(std::string path)
+	std::string Manager::Extension(const std::string& path, size_t end)
 	{
-		const size_t dot = path.rfind('.');
+		end = std::min(end, path.size());
+
+		const size_t dot = end ? path.rfind('.', end - 1) : std::string::npos;
 		if (dot == std::string::npos)
 			return "";
-		return path.substr(dot + 1);
+		return path.substr(dot + 1, end - dot - 1);
 	}
 
-	Error Manager::Import(std::string path)
+	std::string Manager::Format(const std::string& path, std::shared_ptr<ICodec>& codec) const
 	{
 		std::string extension = Extension(path);
 
-		auto importer = importers.find(extension);
-		if (importer == importers.end())
-			return Errors::UnknownExtension;
+		auto found = codecs.find(extension);
+		if (found == codecs.end())
+			return extension;
 
-		mesh = std::make_unique<Mesh>();
+		codec = found->second;	// e.g. "mesh.obj.gz" - the format is the previous extension
+		return Extension(path, path.size() - extension.size() - 1);
+	}
 
-		auto error = importer->second->Import(mesh.get(), path);
+	Error Manager::OpenInput(const std::string& path, std::string& format, std::unique_ptr<IInputStream>& stream) const
+	{
+		std::shared_ptr<ICodec> codec;
+		format = Format(path, codec);
+
+		if (!codec)
+		{
+			auto mapped = std::make_unique<MappedInputStream>(path.c_str());	// importers can scan the whole file in parallel
+			if (mapped->IsOpen())
+			{
+				stream = std::move(mapped);
+				return Errors::Success;
+			}
+		}
+
+		auto file = std::make_unique<FileInputStream>(path.c_str());
+		if (!file->IsOpen())
+			return Errors::CannotOpenFile;	// not found
+
+		stream = std::move(file);
+		if (codec)
+			stream = std::make_unique<ThreadedInputStream>(codec->Decode(std::move(stream)));	// decoding runs in parallel with parsing
+
+		return Errors::Success;
+	}
+
+	Error Manager::OpenOutput(const std::string& path, std::string& format, std::unique_ptr<IOutputStream>& stream) const
+	{
+		std::shared_ptr<ICodec> codec;
+		format = Format(path, codec);
+
+		auto file = std::make_unique<FileOutputStream>(path.c_str());
+		if (!file->IsOpen())
+			return Errors::CannotOpenFile;	// cannot be opened for writing
+
+		stream = std::move(file);
+		if (codec)
+			stream = std::make_unique<ThreadedOutputStream>(codec->Encode(std::move(stream)));	// encoding runs in parallel with exporting
+
+		return Errors::Success;
+	}
+
+	Error Manager::Import(const std::string& path)
+	{
+		auto error = Load(path, mesh);
 		if (error != Errors::Success)
 			return error;
 
-		for (auto& modifier : modifiers)
+		stages.clear();
+		for (auto& modifier : Plan(modifiers))
+		{
+			auto start = std::chrono::high_resolution_clock::now();
 			modifier->Modify(mesh.get());
+			stages.push_back({ modifier, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() });
+		}
 
 		return Errors::Success;
 	}
 
-	Error Manager::Export(std::string path)
+	Error Manager::Load(const std::string& path, std::unique_ptr<Mesh>& mesh) const
 	{
-		std::string extension = Extension(path);
+		std::shared_ptr<ICodec> codec;
+		auto importer = importers.find(Format(path, codec));
+		if (importer == importers.end())
+			return Errors::UnknownExtension;
+
+		std::string format;
+		std::unique_ptr<IInputStream> stream;
 
-		auto exporter = exporters.find(extension);
+		auto error = OpenInput(path, format, stream);
+		if (error != Errors::Success)
+			return error;
+
+		mesh = std::make_unique<Mesh>();
+
+		return importer->second->Import(mesh.get(), stream.get());
+	}
+
+	std::vector<std::shared_ptr<IModifier>> Manager::Plan(const std::vector<std::shared_ptr<IModifier>>& modifiers)
+	{
+		std::vector<std::shared_ptr<IModifier>> plan;
+
+		for (auto& modifier : modifiers)
+		{
+			std::shared_ptr<IModifier> fused;
+			if (!plan.empty())
+				fused = plan.back()->Fuse(*modifier);
+
+			if (fused)
+				plan.back() = fused;
+			else
+				plan.push_back(modifier);
+		}
+
+		return plan;
+	}
+
+	Error Manager::Export(const std::string& path)
+	{
+		std::shared_ptr<ICodec> codec;
+		auto exporter = exporters.find(Format(path, codec));
 		if (exporter == exporters.end())
 			return Errors::UnknownExtension;
 
 		if (!mesh)
 			return Errors::WrongMeshFormat;
 
-		return exporter->second->Export(mesh.get(), path);
+		std::string format;
+		std::unique_ptr<IOutputStream> stream;
+
+		auto error = OpenOutput(path, format, stream);
+		if (error != Errors::Success)
+			return error;
+
+		error = exporter->second->Export(mesh.get(), stream.get());
+		if (error != Errors::Success)
+		{
+			stream.reset();	// closed before removing
+			std::remove(path.c_str());	// no empty or partial files
+		}
+
+		return error;
 	}
 
 	Mesh* Manager::GetMesh() const
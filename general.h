@@ -2,13 +2,18 @@
 
 #include "interface.h"
 #include <functional>
-#include <list>
 #include <map>
 #include <vector>
 #include <glm/glm.hpp>
 
 namespace Converter3D
 {
+	unsigned ThreadsNumber();
+	void SetThreadsNumber(unsigned number);	// 0 - all hardware threads
+
+	// Runs func(begin, end) over [0, count) on all hardware threads, ranges of grain elements are taken dynamically.
+	void ParallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& func, size_t grain = 0);
+
 	// helper function for casting from attribute buffer to glm::vec3
 	inline const glm::vec3& attrib3(const IAttributeBuffer<Float>& attrib, size_t index)
 	{
@@ -51,10 +56,14 @@ namespace Converter3D
 		}
 	};
 
+	// Normals without their own indices and tangents are indexed like the positions, so generated attributes cost no memory per face.
 	template<class T>
 	class Face : public IFace<T>
 	{
-		AttributeBuffer<T> indices[static_cast<size_t>(Attribute::Count)];
+	public:
+		static const size_t Lists = static_cast<size_t>(Attribute::Tangent);	// attributes with own indices
+	private:
+		AttributeBuffer<T> indices[Lists];
 	public:
 		Face()
 		{
@@ -64,7 +73,10 @@ namespace Converter3D
 
 		virtual const IBuffer<T>& Get(Attribute attribute) const override
 		{
-			return indices[static_cast<size_t>(attribute)];
+			const size_t index = static_cast<size_t>(attribute);
+			if (index >= Lists || (attribute == Attribute::Normal && indices[index].empty()))
+				return indices[static_cast<size_t>(Attribute::Position)];
+			return indices[index];
 		}
 
 		virtual size_t GetSize() const override
@@ -108,7 +120,7 @@ namespace Converter3D
 			attributes[static_cast<size_t>(attribute)] = buffer;
 		}
 
-		virtual const std::shared_ptr<IAttributeBuffer<Float>> GetAttribute(Attribute attribute) const override
+		virtual const std::shared_ptr<IAttributeBuffer<Float>>& GetAttribute(Attribute attribute) const override
 		{
 			return attributes[static_cast<size_t>(attribute)];
 		}
@@ -118,7 +130,7 @@ namespace Converter3D
 			Mesh::faces = faces;
 		}
 
-		virtual const std::shared_ptr<IBuffer<IFace<Uint>>> GetFaces() const override
+		virtual const std::shared_ptr<IBuffer<IFace<Uint>>>& GetFaces() const override
 		{
 			return faces;
 		}
@@ -127,37 +139,64 @@ namespace Converter3D
 		Float Volume() const;
 		bool IsInside(const glm::vec3& p) const;
 
+		static size_t CountTriangles(const IMesh& mesh);
+		static std::shared_ptr<FaceBuffer<Uint>> EditableFaces(IMesh& mesh);	// copies the faces if they are not a FaceBuffer
 		static void ForEachTriangle(const IMesh& mesh, std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)> func);
 	};
 
 	class Manager : public IManager
 	{
+	public:
+		struct Stage
+		{
+			std::shared_ptr<IModifier> modifier;
+			double seconds;
+		};
+	private:
 		std::map<std::string, std::shared_ptr<IImporter>> importers;
 		std::map<std::string, std::shared_ptr<IExporter>> exporters;
-		std::list<std::shared_ptr<IModifier>> modifiers;
+		std::map<std::string, std::shared_ptr<ICodec>> codecs;
+		std::vector<std::shared_ptr<IModifier>> modifiers;
+		std::vector<Stage> stages;	// the planned modifiers of the last import
 
 		std::unique_ptr<Mesh> mesh;
 
-		static std::string Extension(std::string path);
+		static std::string Extension(const std::string& path, size_t end = std::string::npos);
+
+		std::string Format(const std::string& path, std::shared_ptr<ICodec>& codec) const;
 	public:
-		virtual void RegisterImporter(std::string extension, std::shared_ptr<IImporter> importer) override
+		virtual void RegisterImporter(const std::string& extension, std::shared_ptr<IImporter> importer) override
 		{
 			importers[extension] = importer;
 		}
 
-		virtual void RegisterExporter(std::string extension, std::shared_ptr<IExporter> exporter) override
+		virtual void RegisterExporter(const std::string& extension, std::shared_ptr<IExporter> exporter) override
 		{
 			exporters[extension] = exporter;
 		}
 
+		virtual void RegisterCodec(const std::string& extension, std::shared_ptr<ICodec> codec) override
+		{
+			codecs[extension] = codec;
+		}
+
 		virtual void AddModifier(std::shared_ptr<IModifier> modifier) override
 		{
 			modifiers.push_back(modifier);
 		}
 
-		virtual Error Import(std::string path) override;
-		virtual Error Export(std::string path) override;
+		virtual Error Import(const std::string& path) override;
+		Error Load(const std::string& path, std::unique_ptr<Mesh>& mesh) const;	// without the modifiers
+		virtual Error Export(const std::string& path) override;
+
+		// file streams with the codec chosen by the extension, format is the extension without the codec one
+		Error OpenInput(const std::string& path, std::string& format, std::unique_ptr<IInputStream>& stream) const;
+		Error OpenOutput(const std::string& path, std::string& format, std::unique_ptr<IOutputStream>& stream) const;
 
 		Mesh* GetMesh() const;
+		const std::vector<Stage>& GetStages() const { return stages; }
+
+		// adjacent modifiers are fused while possible, so the mesh is passed fewer times
+		static std::vector<std::shared_ptr<IModifier>> Plan(const std::vector<std::shared_ptr<IModifier>>& modifiers);
 	};
 }
@@ -18,6 +18,7 @@ namespace Converter3D
 			WrongFileFormat = -2,
 			WrongMeshFormat = -3,
 			UnknownExtension = -4,
+			CorruptedStream = -5,
 		};
 	}
 
@@ -27,6 +28,7 @@ namespace Converter3D
 		Position,
 		Texture,
 		Normal,
+		Tangent,	// xyz and handedness in w, generated from normals and texture coordinates
 
 		Count,
 	};
@@ -64,39 +66,72 @@ namespace Converter3D
 	{
 	public:
 		virtual void SetAttribute(Attribute attribute, std::shared_ptr<IAttributeBuffer<Float>> buffer) = 0;
-		virtual const std::shared_ptr<IAttributeBuffer<Float>> GetAttribute(Attribute attribute) const = 0;
+		virtual const std::shared_ptr<IAttributeBuffer<Float>>& GetAttribute(Attribute attribute) const = 0;
 
 		virtual void SetFaces(std::shared_ptr<IBuffer<IFace<Uint>>> faces) = 0;
-		virtual const std::shared_ptr<IBuffer<IFace<Uint>>> GetFaces() const = 0;
+		virtual const std::shared_ptr<IBuffer<IFace<Uint>>>& GetFaces() const = 0;
+	};
+
+	// Sequential source of bytes. Read returns 0 at the end of the stream or on error.
+	class IInputStream
+	{
+	public:
+		virtual ~IInputStream() = default;
+
+		virtual size_t Read(void* buffer, size_t size) = 0;
+		virtual Error GetError() const = 0;
+	};
+
+	// Sequential sink of bytes. Finish must be called after the last write, it flushes all pending data.
+	class IOutputStream
+	{
+	public:
+		virtual ~IOutputStream() = default;
+
+		virtual size_t Write(const void* data, size_t size) = 0;
+		virtual Error Finish() = 0;
+	};
+
+	// Wraps file streams for transparent reading/writing of encoded (e.g. compressed) files.
+	class ICodec
+	{
+	public:
+		virtual std::unique_ptr<IInputStream> Decode(std::unique_ptr<IInputStream> stream) = 0;
+		virtual std::unique_ptr<IOutputStream> Encode(std::unique_ptr<IOutputStream> stream) = 0;
 	};
 
 	class IImporter
 	{
 	public:
-		virtual Error Import(IMesh* mesh, std::string path) = 0;
+		virtual Error Import(IMesh* mesh, IInputStream* stream) = 0;
 	};
 
 	class IExporter
 	{
 	public:
-		virtual Error Export(const IMesh* mesh, std::string path) = 0;
+		virtual Error Export(const IMesh* mesh, IOutputStream* stream) = 0;
 	};
 
 	class IModifier
 	{
 	public:
 		virtual void Modify(IMesh* mesh) = 0;
+		virtual const char* GetName() const = 0;
+
+		// Combines this modifier with the next one into a single stage, nullptr if they cannot be combined.
+		virtual std::shared_ptr<IModifier> Fuse(const IModifier& next) const = 0;
 	};
 
 	class IManager
 	{
 	public:
-		virtual void RegisterImporter(std::string extension, std::shared_ptr<IImporter> importer) = 0;
-		virtual void RegisterExporter(std::string extension, std::shared_ptr<IExporter> exporter) = 0;
+		virtual void RegisterImporter(const std::string& extension, std::shared_ptr<IImporter> importer) = 0;
+		virtual void RegisterExporter(const std::string& extension, std::shared_ptr<IExporter> exporter) = 0;
+		virtual void RegisterCodec(const std::string& extension, std::shared_ptr<ICodec> codec) = 0;
 
 		virtual void AddModifier(std::shared_ptr<IModifier> modifier) = 0;
 
-		virtual Error Import(std::string path) = 0;
-		virtual Error Export(std::string path) = 0;
+		virtual Error Import(const std::string& path) = 0;
+		virtual Error Export(const std::string& path) = 0;
 	};
 }
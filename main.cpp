@@ -1,9 +1,17 @@
 #include "general.h"
+#include "codec.h"
+#include "compare.h"
 #include "converter.h"
 #include "modifier.h"
+#include "outofcore.h"
+#include "voxel.h"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <iostream>
 #include <optional>
+#include <utility>
+#include <vector>
 
 using namespace Converter3D;
 
@@ -11,6 +19,12 @@ static int g_argc;
 static char** g_argv;
 static int g_arg;
 
+[[noreturn]] void Usage(const char* usage)
+{
+    std::cout << "Usage: '" << usage << "'" << std::endl;
+    exit(-1);
+}
+
 bool Command(const char* command, int arguments, const char* usage, std::function<void(char** argv)> parse)
 {
     if (strcmp(command, g_argv[g_arg]))
@@ -24,8 +38,107 @@ bool Command(const char* command, int arguments, const char* usage, std::functio
         return true;
     }
 
-    std::cout << "Usage: '" << usage << "'" << std::endl;
-    exit(-1);
+    Usage(usage);
+}
+
+// false for the first word, true for the second one, anything else is a usage error
+bool Choice(const char* word, const char* first, const char* second, const char* usage)
+{
+    if (!strcmp(word, first))
+        return false;
+    if (!strcmp(word, second))
+        return true;
+
+    Usage(usage);
+}
+
+// Streaming passes over a mesh in temporary files, the RAM budget limits the mapped pages.
+int OutOfCore(const Manager& manager, size_t budget, const std::string& ipath, const std::string& opath, const TransformModifier* modifier, bool measure, bool area, bool volume)
+{
+    OutOfCoreMesh mesh(budget);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t loads = 0;
+
+    // time, throughput and page loads of every pass show how the budget affects the speed
+    auto report = [&](const char* pass)
+    {
+        auto now = std::chrono::high_resolution_clock::now();
+
+        if (measure)
+        {
+            const double seconds = std::chrono::duration<double>(now - start).count();
+            std::cout << pass << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() << "ms, "
+                << static_cast<size_t>(mesh.GetTrianglesNumber() / std::max(seconds, 1e-9) / 1000) << "K triangles/s, "
+                << mesh.GetPageLoads() - loads << " page loads" << std::endl;
+        }
+
+        start = now;
+        loads = mesh.GetPageLoads();
+    };
+
+    std::string format;
+    std::unique_ptr<IInputStream> input;
+
+    Error error = manager.OpenInput(ipath, format, input);
+    if (error == Errors::Success)
+        error = format == "obj" ? ObjImporter().Import(&mesh, input.get()) : Errors::UnknownExtension;
+
+    input.reset();
+
+    if (error != Errors::Success)
+    {
+        std::cout << "Import error: " << error << std::endl;
+        return -1;
+    }
+
+    report("Import");
+
+    if (modifier)
+    {
+        mesh.Transform(modifier->GetTransform());
+        report("Transform");
+    }
+
+    if (!opath.empty())
+    {
+        std::unique_ptr<IOutputStream> output;
+
+        error = manager.OpenOutput(opath, format, output);
+        if (error == Errors::Success)
+            error = format == "stl" ? StlExporter().Export(&mesh, output.get()) : Errors::UnknownExtension;
+
+        if (error != Errors::Success)
+        {
+            output.reset();
+            std::remove(opath.c_str());	// no empty or partial files
+
+            std::cout << "Export error: " << error << std::endl;
+            return -1;
+        }
+
+        report("Export");
+    }
+
+    if (area)
+    {
+        std::cout << "Area: " << mesh.Area() << std::endl;
+        report("Area");
+    }
+
+    if (volume)
+    {
+        std::cout << "Volume: " << mesh.Volume() << std::endl;
+        report("Volume");
+    }
+
+    if (mesh.GetError() != Errors::Success)
+    {
+        std::cout << "Out-of-core error: " << mesh.GetError() << std::endl;
+        return -1;
+    }
+
+    return 0;
 }
 
 int main(int argc, char** argv)
@@ -42,6 +155,15 @@ int main(int argc, char** argv)
     mesh area:      -a
     mesh volume:    -v
     test point:     -p <x> <y> <z>
+    level of detail: -l <triangles> <path>
+    LOD max error:  -e <distance>
+    vertex normals: -n <area|angle>
+    with tangents:  -g
+    threads:        -j <number>
+    out-of-core:    -c <megabytes>
+    geometric hash: -h
+    compare:        -d <path> <tolerance>
+    voxelize:       -x <resolution> <dense|sparse> <path>
 )";
         return 0;
     }
@@ -51,15 +173,38 @@ int main(int argc, char** argv)
 
     Manager manager;
     manager.RegisterImporter("obj", std::make_shared<ObjImporter>());
+    manager.RegisterImporter("stl", std::make_shared<StlImporter>());
     manager.RegisterExporter("stl", std::make_shared<StlExporter>());
+    manager.RegisterExporter("obj", std::make_shared<ObjExporter>());
+    manager.RegisterCodec("gz", std::make_shared<GzipCodec>());
 
     std::string ipath, opath;
-    std::shared_ptr<TransformModifier> modifier;
+    std::vector<std::shared_ptr<IModifier>> modifiers;	// in the command line order
+    size_t budget = 0;
 
     bool measure = false;
     bool area = false;
     bool volume = false;
     std::optional<glm::vec3> point;
+    bool hash = false;
+    std::string cpath;
+    Float tolerance = 0.f;
+
+    size_t voxels = 0;
+    bool sparse = false;
+    std::string vpath;
+
+    auto weighting = NormalModifier::Weighting::Area;	// of the last normals, also for the tangents
+
+    std::vector<std::pair<size_t, std::string>> lods;
+    Float lod_error = std::numeric_limits<Float>::max();
+
+    auto transform = [&]()
+    {
+        auto modifier = std::make_shared<TransformModifier>();
+        modifiers.push_back(modifier);
+        return modifier;
+    };
 
     for(g_arg = 1; g_arg < argc;)
     {
@@ -73,21 +218,15 @@ int main(int argc, char** argv)
             }))
         if (!Command("-t", 3, "-t <x> <y> <z>", [&](auto argv)
             {
-                if (!modifier)
-                    modifier = std::make_shared<TransformModifier>();
-                modifier->Translate(glm::vec3(atof(argv[0]), atof(argv[1]), atof(argv[2])));
+                transform()->Translate(glm::vec3(atof(argv[0]), atof(argv[1]), atof(argv[2])));
             }))
         if (!Command("-r", 4, "-r <deg> <x> <y> <z>", [&](auto argv)
             {
-                if (!modifier)
-                    modifier = std::make_shared<TransformModifier>();
-                modifier->Rotate((float)glm::radians(atof(argv[0])), glm::vec3(atof(argv[1]), atof(argv[2]), atof(argv[3])));
+                transform()->Rotate((float)glm::radians(atof(argv[0])), glm::vec3(atof(argv[1]), atof(argv[2]), atof(argv[3])));
             }))
         if (!Command("-s", 3, "-r <x> <y> <z>", [&](auto argv)
             {
-                if (!modifier)
-                    modifier = std::make_shared<TransformModifier>();
-                modifier->Scale(glm::vec3(atof(argv[0]), atof(argv[1]), atof(argv[2])));
+                transform()->Scale(glm::vec3(atof(argv[0]), atof(argv[1]), atof(argv[2])));
             }))
         if (!Command("-m", 0, "", [&](auto argv)
             {
@@ -105,6 +244,52 @@ int main(int argc, char** argv)
             {
                 point = glm::vec3(atof(argv[0]), atof(argv[1]), atof(argv[2]));
             }))
+        if (!Command("-l", 2, "-l <triangles> <path>", [&](auto argv)
+            {
+                lods.emplace_back(static_cast<size_t>(atoll(argv[0])), argv[1]);
+            }))
+        if (!Command("-e", 1, "-e <distance>", [&](auto argv)
+            {
+                lod_error = static_cast<Float>(atof(argv[0]));
+            }))
+        if (!Command("-n", 1, "-n <area|angle>", [&](auto argv)
+            {
+                weighting = Choice(argv[0], "area", "angle", "-n <area|angle>") ? NormalModifier::Weighting::Angle : NormalModifier::Weighting::Area;
+                modifiers.push_back(std::make_shared<NormalModifier>(weighting));
+            }))
+        if (!Command("-g", 0, "", [&](auto argv)
+            {
+                modifiers.push_back(std::make_shared<NormalModifier>(weighting, true));
+            }))
+        if (!Command("-j", 1, "-j <number>", [&](auto argv)
+            {
+                // 0 is the number of cores, every thread is a std::thread, so huge numbers are rejected too
+                char* end;
+                const long number = strtol(argv[0], &end, 10);
+                if (end == argv[0] || *end || number < 0 || number > 1024)
+                    Usage("-j <number>");
+
+                SetThreadsNumber(static_cast<unsigned>(number));
+            }))
+        if (!Command("-c", 1, "-c <megabytes>", [&](auto argv)
+            {
+                budget = static_cast<size_t>(atof(argv[0]) * 1024 * 1024);
+            }))
+        if (!Command("-h", 0, "", [&](auto argv)
+            {
+                hash = true;
+            }))
+        if (!Command("-d", 2, "-d <path> <tolerance>", [&](auto argv)
+            {
+                cpath = argv[0];
+                tolerance = static_cast<Float>(atof(argv[1]));
+            }))
+        if (!Command("-x", 3, "-x <resolution> <dense|sparse> <path>", [&](auto argv)
+            {
+                voxels = static_cast<size_t>(atoll(argv[0]));
+                sparse = Choice(argv[1], "dense", "sparse", "-x <resolution> <dense|sparse> <path>");
+                vpath = argv[2];
+            }))
         {
             std::cout << "Unknown command: " << g_argv[g_arg] << std::endl;
             return -1;
@@ -117,7 +302,31 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    if (modifier)
+    if (budget)
+    {
+        // all the transformations are fused into one matrix, anything else can not be streamed
+        std::shared_ptr<TransformModifier> composed;
+        bool transforms = true;
+
+        for (auto& modifier : modifiers)
+        {
+            auto next = std::dynamic_pointer_cast<TransformModifier>(modifier);
+            if (!next)
+                transforms = false;
+            else
+                composed = composed ? std::static_pointer_cast<TransformModifier>(composed->Fuse(*next)) : next;
+        }
+
+        if (point || !transforms || !lods.empty() || hash || !cpath.empty() || voxels)
+        {
+            std::cout << "Only transformations, area, volume and export are supported out-of-core." << std::endl;
+            return -1;
+        }
+
+        return OutOfCore(manager, budget, ipath, opath, composed.get(), measure, area, volume);
+    }
+
+    for (auto& modifier : modifiers)
         manager.AddModifier(modifier);
 
     auto start = std::chrono::high_resolution_clock::now();
@@ -126,7 +335,10 @@ int main(int argc, char** argv)
 
     error = manager.Import(ipath);
     if(error != Errors::Success)
+    {
         std::cout << "Import error: " << error << std::endl;
+        return -1;	// there is no mesh for the other commands
+    }
 
     auto afterImport = std::chrono::high_resolution_clock::now();
 
@@ -150,12 +362,111 @@ int main(int argc, char** argv)
 
     auto afterMath = std::chrono::high_resolution_clock::now();
 
+    if (error == Errors::Success && hash)
+    {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(Hash(*manager.GetMesh())));
+        std::cout << "Hash: " << text << std::endl;
+    }
+
+    // the result of the conversion against a reference mesh, e.g. the output of another build
+    bool different = false;
+
+    if (error == Errors::Success && !cpath.empty())
+    {
+        std::unique_ptr<Mesh> reference;
+
+        error = manager.Load(cpath, reference);
+        if (error != Errors::Success)
+            std::cout << "Compare error: " << error << std::endl;
+        else
+        {
+            auto difference = Compare(*manager.GetMesh(), *reference);
+
+            std::cout << "Triangles: " << difference.triangles[0] << " vs " << difference.triangles[1] << std::endl;
+            std::cout << "Area delta: " << difference.areas[1] - difference.areas[0] << std::endl;
+            std::cout << "Volume delta: " << difference.volumes[1] - difference.volumes[0] << std::endl;
+            std::cout << "Hausdorff distance: " << difference.hausdorff << std::endl;
+
+            different = difference.hausdorff > tolerance;
+            std::cout << "Meshes are " << (different ? "different" : "equal") << std::endl;
+        }
+    }
+
+    auto afterCompare = std::chrono::high_resolution_clock::now();
+
+    if (error == Errors::Success && voxels)
+    {
+        VoxelGrid grid(*manager.GetMesh(), voxels);
+
+        std::string format;
+        std::unique_ptr<IOutputStream> output;
+
+        error = manager.OpenOutput(vpath, format, output);
+        if (error == Errors::Success)
+            error = grid.Write(output.get(), sparse);
+
+        if (error != Errors::Success)
+        {
+            if (output)
+            {
+                output.reset();	// closed before removing
+                std::remove(vpath.c_str());	// no empty or partial files, a file which could not be opened is kept
+            }
+
+            std::cout << "Voxelize error: " << error << std::endl;
+        }
+        else
+            std::cout << "Voxels: " << grid.CountVoxels() << " of " << grid.GetResolution(0) << "x" << grid.GetResolution(1) << "x" << grid.GetResolution(2) << std::endl;
+    }
+
+    auto afterVoxelize = std::chrono::high_resolution_clock::now();
+
     if (measure)
     {
         std::cout << "Import: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterImport - start).count() << "ms" << std::endl;
+        for (auto& stage : manager.GetStages())
+            std::cout << "  " << stage.modifier->GetName() << ": " << static_cast<long long>(stage.seconds * 1000) << "ms" << std::endl;
         std::cout << "Export: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterExport - afterImport).count() << "ms" << std::endl;
         std::cout << "Math: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterMath - afterExport).count() << "ms" << std::endl;
+        if (hash || !cpath.empty())
+            std::cout << "Compare: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterCompare - afterMath).count() << "ms" << std::endl;
+        if (voxels)
+            std::cout << "Voxelize: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterVoxelize - afterCompare).count() << "ms" << std::endl;
     }
 
-    return 0;
+    // every level is simplified from the previous more detailed one, the input is parsed only once
+    std::sort(lods.begin(), lods.end(), [](auto& a, auto& b) { return a.first > b.first; });
+
+    for (auto& lod : lods)
+    {
+        if (error != Errors::Success)
+            break;
+
+        auto beforeLod = std::chrono::high_resolution_clock::now();
+
+        SimplifyModifier(lod.first, lod_error).Modify(manager.GetMesh());
+
+        auto afterSimplify = std::chrono::high_resolution_clock::now();
+
+        error = manager.Export(lod.second);
+        if (error != Errors::Success)
+            std::cout << "Export error: " << error << std::endl;
+
+        auto afterLod = std::chrono::high_resolution_clock::now();
+
+        std::cout << "LOD " << lod.second << ": " << Mesh::CountTriangles(*manager.GetMesh()) << " triangles" << std::endl;
+
+        if (measure)
+        {
+            std::cout << "Simplify: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterSimplify - beforeLod).count() << "ms" << std::endl;
+            std::cout << "Export: " << std::chrono::duration_cast<std::chrono::milliseconds>(afterLod - afterSimplify).count() << "ms" << std::endl;
+        }
+    }
+
+    // for scripts: a failed import, export or comparison is -1, different meshes are 1
+    if (error != Errors::Success)
+        return -1;
+
+    return different ? 1 : 0;
 }
@@ -1,4 +1,10 @@
 #include "modifier.h"
+#include "general.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <queue>
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/transform.hpp>
 
@@ -18,10 +24,10 @@ namespace Converter3D
 
 	void TransformModifier::Modify(IMesh* mesh)
 	{
-		std::shared_ptr<IAttributeBuffer<Float>> attributes[] =
+		IAttributeBuffer<Float>* attributes[] =
 		{
-			mesh->GetAttribute(Attribute::Position),
-			mesh->GetAttribute(Attribute::Normal),
+			mesh->GetAttribute(Attribute::Position).get(),
+			mesh->GetAttribute(Attribute::Normal).get(),
 		};
 
 		if (attributes[0])
@@ -41,6 +47,31 @@ namespace Converter3D
 			auto normal = glm::inverseTranspose(transform);
 			Multiply(reinterpret_cast<glm::vec3*>(attributes[1]->GetPointer()), attributes[1]->GetSize(), normal);
 		}
+
+		auto& tangents = mesh->GetAttribute(Attribute::Tangent);
+		if (tangents && tangents->GetDimension() == 4)
+		{
+			const float handedness = glm::determinant(glm::mat3(transform)) < 0.f ? -1.f : 1.f;	// mirroring flips the bitangent
+
+			auto vertices = reinterpret_cast<glm::vec4*>(tangents->GetPointer());
+			for (size_t i = 0; i < tangents->GetSize(); i++)
+				vertices[i] = glm::vec4(glm::vec3(transform * glm::vec4(glm::vec3(vertices[i]), 0.f)), vertices[i].w * handedness);
+		}
+	}
+
+	std::shared_ptr<IModifier> TransformModifier::Fuse(const IModifier& next) const
+	{
+		if (auto next_transform = dynamic_cast<const TransformModifier*>(&next))
+		{
+			auto fused = std::make_shared<TransformModifier>(*this);
+			fused->transform = next_transform->transform * transform;
+			return fused;
+		}
+
+		if (auto next_normals = dynamic_cast<const NormalModifier*>(&next))
+			return next_normals->Prepend(transform);
+
+		return nullptr;
 	}
 
 	void TransformModifier::Translate(const glm::vec3& v)
@@ -57,4 +88,684 @@ namespace Converter3D
 	{
 		transform = glm::scale(v) * transform;
 	}
+
+	namespace
+	{
+		// symmetric 4x4 matrix of the sum of squared distances to planes
+		struct Quadric
+		{
+			double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+			double weight = 0;	// sum of the plane weights, the error divided by it is a mean squared distance
+
+			Quadric() = default;
+
+			// plane a*x + b*y + c*z + d = 0
+			Quadric(double a, double b, double c, double d, double weight) :
+				xx(a * a * weight), xy(a * b * weight), xz(a * c * weight), xw(a * d * weight),
+				yy(b * b * weight), yz(b * c * weight), yw(b * d * weight),
+				zz(c * c * weight), zw(c * d * weight),
+				ww(d * d * weight),
+				weight(weight)
+			{
+			}
+
+			Quadric& operator+=(const Quadric& q)
+			{
+				xx += q.xx; xy += q.xy; xz += q.xz; xw += q.xw;
+				yy += q.yy; yz += q.yz; yw += q.yw;
+				zz += q.zz; zw += q.zw;
+				ww += q.ww;
+				weight += q.weight;
+				return *this;
+			}
+
+			double Evaluate(const glm::vec3& p) const
+			{
+				const double x = p.x, y = p.y, z = p.z;
+				return xx * x * x + 2 * xy * x * y + 2 * xz * x * z + 2 * xw * x
+					+ yy * y * y + 2 * yz * y * z + 2 * yw * y
+					+ zz * z * z + 2 * zw * z
+					+ ww;
+			}
+
+			// the point with the minimal error, false if the matrix is singular
+			bool Optimal(glm::vec3& p) const
+			{
+				const double c00 = yy * zz - yz * yz;
+				const double c01 = xz * yz - xy * zz;
+				const double c02 = xy * yz - xz * yy;
+
+				const double det = xx * c00 + xy * c01 + xz * c02;
+				const double trace = xx + yy + zz;
+
+				if (std::fabs(det) <= 1e-10 * trace * trace * trace)
+					return false;
+
+				const double c11 = xx * zz - xz * xz;
+				const double c12 = xy * xz - xx * yz;
+				const double c22 = xx * yy - xy * xy;
+
+				p.x = static_cast<float>(-(c00 * xw + c01 * yw + c02 * zw) / det);
+				p.y = static_cast<float>(-(c01 * xw + c11 * yw + c12 * zw) / det);
+				p.z = static_cast<float>(-(c02 * xw + c12 * yw + c22 * zw) / det);
+
+				return true;
+			}
+		};
+
+		struct Collapse
+		{
+			double cost;		// area weighted, orders the collapses
+			double error;		// mean squared distance to the planes, independent of the tessellation
+			Uint from, to;
+			uint32_t from_stamp, to_stamp;
+			glm::vec3 position;
+
+			bool operator<(const Collapse& c) const { return cost > c.cost; }	// min-heap
+		};
+
+		class Simplifier
+		{
+			std::vector<glm::vec3>& positions;
+			std::vector<std::array<Uint, 3>>& triangles;
+
+			std::vector<Quadric> quadrics;
+			std::vector<std::vector<Uint>> adjacency;	// vertex -> triangles
+			std::vector<uint32_t> stamps;				// changes when the vertex is moved
+			std::vector<char> removed;					// triangles
+			std::vector<char> collapsed;				// vertices
+
+			std::vector<uint32_t> cells;
+			std::vector<char> locked;
+
+			double max_error;	// squared
+
+			static bool Contains(const std::array<Uint, 3>& triangle, Uint vertex)
+			{
+				return triangle[0] == vertex || triangle[1] == vertex || triangle[2] == vertex;
+			}
+
+			void Neighbors(Uint vertex, std::vector<Uint>& neighbors) const
+			{
+				neighbors.clear();
+				for (auto t : adjacency[vertex])
+					if (!removed[t])
+						for (auto v : triangles[t])
+							if (v != vertex)
+								neighbors.push_back(v);
+
+				std::sort(neighbors.begin(), neighbors.end());
+				neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+			}
+
+			Collapse Evaluate(Uint from, Uint to) const
+			{
+				Quadric q = quadrics[from];
+				q += quadrics[to];
+
+				Collapse collapse{ 0, 0, from, to, stamps[from], stamps[to], {} };
+
+				if (!q.Optimal(collapse.position))
+				{
+					const glm::vec3 candidates[] = { positions[from], positions[to], (positions[from] + positions[to]) * 0.5f };
+
+					collapse.cost = std::numeric_limits<double>::max();
+					for (auto& candidate : candidates)
+					{
+						const double cost = q.Evaluate(candidate);
+						if (cost < collapse.cost)
+						{
+							collapse.cost = cost;
+							collapse.position = candidate;
+						}
+					}
+				}
+				else
+					collapse.cost = q.Evaluate(collapse.position);
+
+				collapse.cost = std::max(collapse.cost, 0.0);	// rounding
+				collapse.error = q.weight > 0 ? collapse.cost / q.weight : 0;
+				return collapse;
+			}
+
+			// link condition and normal flips
+			bool IsValid(const Collapse& collapse, std::vector<Uint>& a, std::vector<Uint>& b) const
+			{
+				size_t shared = 0;
+				for (auto t : adjacency[collapse.from])
+					if (!removed[t] && Contains(triangles[t], collapse.to))
+						shared++;
+
+				Neighbors(collapse.from, a);
+				Neighbors(collapse.to, b);
+
+				size_t common = 0;
+				for (size_t i = 0, j = 0; i < a.size() && j < b.size();)
+				{
+					if (a[i] < b[j])
+						i++;
+					else if (b[j] < a[i])
+						j++;
+					else
+						common++, i++, j++;
+				}
+
+				if (common != shared)
+					return false;	// would create a non-manifold edge
+
+				for (auto vertex : { collapse.from, collapse.to })
+					for (auto t : adjacency[vertex])
+					{
+						auto& triangle = triangles[t];
+						if (removed[t] || (Contains(triangle, collapse.from) && Contains(triangle, collapse.to)))
+							continue;
+
+						glm::vec3 corners[3];
+						for (int i = 0; i < 3; i++)
+							corners[i] = triangle[i] == vertex ? collapse.position : positions[triangle[i]];
+
+						const auto before = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+						const auto after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+						if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+							return false;	// flipped, degenerated or turned too much
+					}
+
+				return true;
+			}
+
+			size_t SimplifyCell(const std::vector<size_t>& cell_triangles, size_t goal)
+			{
+				std::priority_queue<Collapse> queue;
+				std::vector<Uint> a, b;
+
+				auto push = [&](Uint u, Uint v)
+				{
+					if (!locked[u] && !locked[v])
+						queue.push(Evaluate(u, v));
+				};
+
+				for (auto t : cell_triangles)
+					for (int i = 0; i < 3; i++)
+						push(triangles[t][i], triangles[t][(i + 1) % 3]);
+
+				size_t number = 0;
+
+				while (number < goal && !queue.empty())
+				{
+					const Collapse collapse = queue.top();
+					queue.pop();
+
+					if (collapsed[collapse.from] || collapsed[collapse.to] || stamps[collapse.from] != collapse.from_stamp || stamps[collapse.to] != collapse.to_stamp)
+						continue;	// outdated
+
+					if (collapse.error > max_error)
+						continue;	// the cheaper collapses can still be within the error
+
+					if (!IsValid(collapse, a, b))
+						continue;
+
+					const Uint from = collapse.from;
+					const Uint to = collapse.to;
+
+					positions[to] = collapse.position;
+					quadrics[to] += quadrics[from];
+					collapsed[from] = 1;
+					stamps[to]++;
+
+					for (auto t : adjacency[from])
+					{
+						if (removed[t])
+							continue;
+
+						auto& triangle = triangles[t];
+						if (Contains(triangle, to))
+						{
+							removed[t] = 1;
+							triangle = { to, to, to };	// degenerated, skipped in the result
+							number++;
+						}
+						else
+						{
+							std::replace(triangle.begin(), triangle.end(), from, to);
+							adjacency[to].push_back(t);
+						}
+					}
+
+					adjacency[from].clear();
+					adjacency[to].erase(std::remove_if(adjacency[to].begin(), adjacency[to].end(), [this](auto t) { return removed[t]; }), adjacency[to].end());
+
+					Neighbors(to, a);
+					for (auto v : a)
+						push(to, v);
+				}
+
+				return number;
+			}
+
+		public:
+			Simplifier(std::vector<glm::vec3>& positions, std::vector<std::array<Uint, 3>>& triangles, Float max_error) :
+				positions(positions),
+				triangles(triangles),
+				quadrics(positions.size()),
+				adjacency(positions.size()),
+				stamps(positions.size()),
+				removed(triangles.size()),
+				collapsed(positions.size()),
+				cells(positions.size()),
+				locked(positions.size()),
+				max_error(static_cast<double>(max_error) * max_error)
+			{
+				for (size_t t = 0; t < triangles.size(); t++)
+					for (auto v : triangles[t])
+						adjacency[v].push_back(static_cast<Uint>(t));
+
+				auto plane = [&](size_t t)
+				{
+					auto& triangle = triangles[t];
+					const glm::vec3 normal = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+					const float length = glm::length(normal);
+					if (length == 0.f)
+						return Quadric();
+
+					const glm::vec3 n = normal / length;
+					return Quadric(n.x, n.y, n.z, -glm::dot(n, positions[triangle[0]]), length / 2.f);	// weighted by area
+				};
+
+				ParallelFor(positions.size(), [&](size_t begin, size_t end)
+					{
+						for (size_t v = begin; v < end; v++)
+							for (auto t : adjacency[v])
+								quadrics[v] += plane(t);
+					});
+
+				// boundary edges are kept in place by perpendicular planes
+				std::vector<std::array<Uint, 3>> edges;	// first vertex, second vertex, triangle
+				edges.reserve(triangles.size() * 3);
+				for (size_t t = 0; t < triangles.size(); t++)
+					for (int i = 0; i < 3; i++)
+					{
+						Uint u = triangles[t][i], v = triangles[t][(i + 1) % 3];
+						edges.push_back({ std::min(u, v), std::max(u, v), static_cast<Uint>(t) });
+					}
+
+				std::sort(edges.begin(), edges.end());
+
+				for (size_t i = 0; i < edges.size();)
+				{
+					size_t j = i + 1;
+					while (j < edges.size() && edges[j][0] == edges[i][0] && edges[j][1] == edges[i][1])
+						j++;
+
+					if (j - i == 1)
+					{
+						auto& triangle = triangles[edges[i][2]];
+						const glm::vec3& p = positions[edges[i][0]];
+						const glm::vec3 edge = positions[edges[i][1]] - p;
+						const glm::vec3 normal = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+						const glm::vec3 perpendicular = glm::cross(edge, normal);
+						const float length = glm::length(perpendicular);
+
+						if (length > 0.f)
+						{
+							const glm::vec3 n = perpendicular / length;
+							const Quadric q(n.x, n.y, n.z, -glm::dot(n, p), glm::dot(edge, edge) * 10.f);
+							quadrics[edges[i][0]] += q;
+							quadrics[edges[i][1]] += q;
+						}
+					}
+
+					i = j;
+				}
+			}
+
+			// returns the number of removed triangles
+			size_t Pass(size_t pass, size_t alive, size_t target)
+			{
+				glm::vec3 min(std::numeric_limits<float>::max());
+				glm::vec3 max(-std::numeric_limits<float>::max());
+				for (size_t v = 0; v < positions.size(); v++)
+					if (!collapsed[v])
+					{
+						min = glm::min(min, positions[v]);
+						max = glm::max(max, positions[v]);
+					}
+
+				// several cells per thread for load balancing, but not too small ones, the grid is shifted every pass
+				const size_t MinCellTriangles = 4096;
+				const double cells_number = std::min<double>(ThreadsNumber() * 8.0, static_cast<double>(alive / MinCellTriangles));
+				const unsigned resolution = static_cast<unsigned>(std::ceil(std::cbrt(std::max(cells_number, 1.0))));
+				const glm::vec3 size = glm::max((max - min) / static_cast<float>(resolution), glm::vec3(1e-20f));
+				const float shift = static_cast<float>(std::fmod(pass * 0.618034, 1.0));
+				const glm::vec3 origin = min - size * shift;
+				const unsigned cells_per_axis = resolution + 1;
+
+				ParallelFor(positions.size(), [&](size_t begin, size_t end)
+					{
+						for (size_t v = begin; v < end; v++)
+						{
+							if (resolution == 1)
+							{
+								cells[v] = 0;	// small mesh, simplified as a whole
+								continue;
+							}
+
+							const glm::vec3 cell = glm::clamp(glm::floor((positions[v] - origin) / size), glm::vec3(0.f), glm::vec3(static_cast<float>(resolution)));
+							cells[v] = static_cast<uint32_t>((cell.z * cells_per_axis + cell.y) * cells_per_axis + cell.x);
+						}
+					});
+
+				ParallelFor(positions.size(), [&](size_t begin, size_t end)
+					{
+						for (size_t v = begin; v < end; v++)
+						{
+							locked[v] = 0;
+							for (auto t : adjacency[v])
+								if (!removed[t])
+									for (auto u : triangles[t])
+										locked[v] |= cells[u] != cells[v];
+						}
+					});
+
+				std::vector<std::vector<size_t>> cell_triangles(static_cast<size_t>(cells_per_axis) * cells_per_axis * cells_per_axis);
+				for (size_t t = 0; t < triangles.size(); t++)
+				{
+					auto& triangle = triangles[t];
+					if (!removed[t] && cells[triangle[0]] == cells[triangle[1]] && cells[triangle[0]] == cells[triangle[2]])
+						cell_triangles[cells[triangle[0]]].push_back(t);
+				}
+
+				std::atomic<size_t> number{ 0 };
+
+				ParallelFor(cell_triangles.size(), [&](size_t begin, size_t end)
+					{
+						for (size_t c = begin; c < end; c++)
+						{
+							if (cell_triangles[c].empty())
+								continue;
+
+							// every cell removes its share of the excess, but at most a half per pass,
+							// otherwise cell interiors become much coarser than the locked borders
+							const size_t share = target ? (alive - target) * cell_triangles[c].size() / alive + 1 : alive;
+							const size_t goal = std::min(share, cell_triangles[c].size() / 2 + 1);
+							number += SimplifyCell(cell_triangles[c], goal);
+						}
+					}, 1);
+
+				return number;
+			}
+		};
+	}
+
+	void SimplifyModifier::Modify(IMesh* mesh)
+	{
+		auto& attribute = mesh->GetAttribute(Attribute::Position);
+		auto& faces = mesh->GetFaces();
+
+		if (!attribute || attribute->GetDimension() != 3 || !faces)
+			return;
+
+		const size_t triangles_number = Mesh::CountTriangles(*mesh);
+		if (triangles_number <= target)
+			return;	// small enough, the mesh keeps its polygons and attributes
+
+		std::vector<glm::vec3> positions(attribute->GetSize());
+		for (size_t i = 0; i < positions.size(); i++)
+			positions[i] = attrib3(*attribute, i);
+
+		std::vector<std::array<Uint, 3>> triangles;
+		triangles.reserve(triangles_number);
+
+		const auto faces_num = faces->GetSize();
+		for (size_t f = 0; f < faces_num; f++)
+		{
+			auto& indices = faces->Get(f).Get(Attribute::Position);
+			for (size_t i = 2; i < indices.GetSize(); i++)
+				triangles.push_back({ indices.Get(0), indices.Get(i - 1), indices.Get(i) });
+		}
+
+		size_t alive = triangles.size();
+
+		{
+			Simplifier simplifier(positions, triangles, max_error);
+
+			const size_t MaxPasses = 32;
+			for (size_t pass = 0, idle = 0; pass < MaxPasses && alive > target && idle < 2; pass++)
+			{
+				const size_t number = simplifier.Pass(pass, alive, target);
+				alive -= number;
+				idle = number ? 0 : idle + 1;	// one idle pass can be caused by the grid position
+			}
+		}
+
+		if (alive == triangles.size())
+			return;	// nothing was collapsed, e.g. every collapse exceeds the max error
+
+		// compact the result
+		std::vector<Uint> remap(positions.size(), std::numeric_limits<Uint>::max());
+
+		auto result_positions = std::make_shared<AttributeBuffer<Float>>(3);
+		auto result_faces = std::make_shared<FaceBuffer<Uint>>();
+		result_faces->reserve(alive);
+
+		for (auto& triangle : triangles)
+		{
+			if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0])
+				continue;	// removed
+
+			Face<Uint>& face = result_faces->emplace_back();
+			for (auto v : triangle)
+			{
+				if (remap[v] == std::numeric_limits<Uint>::max())
+				{
+					remap[v] = static_cast<Uint>(result_positions->GetSize());
+					result_positions->insert(result_positions->end(), { positions[v].x, positions[v].y, positions[v].z });
+				}
+				face[static_cast<size_t>(Attribute::Position)].push_back(remap[v]);
+			}
+		}
+
+		mesh->SetAttribute(Attribute::Position, result_positions);
+		mesh->SetAttribute(Attribute::Texture, nullptr);
+		mesh->SetAttribute(Attribute::Normal, nullptr);
+		mesh->SetAttribute(Attribute::Tangent, nullptr);
+		mesh->SetFaces(result_faces);
+	}
+
+	std::shared_ptr<IModifier> NormalModifier::Fuse(const IModifier& next) const
+	{
+		auto next_normals = dynamic_cast<const NormalModifier*>(&next);
+		if (!next_normals)
+			return nullptr;
+
+		// the next one overwrites the normals, only the transformation is kept
+		return transform ? next_normals->Prepend(*transform) : std::make_shared<NormalModifier>(*next_normals);
+	}
+
+	std::shared_ptr<NormalModifier> NormalModifier::Prepend(const glm::mat4& matrix) const
+	{
+		auto fused = std::make_shared<NormalModifier>(*this);
+		fused->transform = transform ? *transform * matrix : matrix;
+		return fused;
+	}
+
+	void NormalModifier::Modify(IMesh* mesh)
+	{
+		auto& positions = mesh->GetAttribute(Attribute::Position);
+		auto& texture = mesh->GetAttribute(Attribute::Texture);
+
+		if (transform && positions && positions->GetDimension() >= 3)
+		{
+			const size_t dimension = positions->GetDimension();
+
+			ParallelFor(positions->GetSize(), [&](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						Float* p = positions->GetPointer() + i * dimension;
+						const glm::vec4 result = *transform * glm::vec4(p[0], p[1], p[2], dimension == 4 ? p[3] : 1.f);
+
+						for (size_t k = 0; k < dimension; k++)
+							p[k] = result[static_cast<int>(k)];
+					}
+				});
+		}
+
+		if (!positions || positions->GetDimension() != 3 || !mesh->GetFaces())
+			return;
+
+		auto faces = Mesh::EditableFaces(*mesh);
+
+		const size_t vertices_number = positions->GetSize();
+		const size_t faces_number = faces->size();
+		const bool with_tangents = tangents && texture && texture->GetDimension() >= 2;
+
+		// the first triangle of every face
+		std::vector<size_t> offsets(faces_number + 1);
+		for (size_t f = 0; f < faces_number; f++)
+			offsets[f + 1] = offsets[f] + std::max<size_t>((*faces)[f].GetSize(), 2) - 2;
+
+		const size_t triangles_number = offsets.back();
+
+		std::vector<Uint> corner_vertices(triangles_number * 3);
+		std::vector<glm::vec3> corner_normals(triangles_number * 3);
+		std::vector<glm::vec3> triangle_tangents(with_tangents ? triangles_number : 0);
+		std::vector<glm::vec3> triangle_bitangents(with_tangents ? triangles_number : 0);
+
+		// scatter: every triangle writes only its own corners
+		ParallelFor(faces_number, [&](size_t begin, size_t end)
+			{
+				for (size_t f = begin; f < end; f++)
+				{
+					auto& indices = (*faces)[f][static_cast<size_t>(Attribute::Position)];
+					auto& uvs = (*faces)[f][static_cast<size_t>(Attribute::Texture)];
+
+					for (size_t i = 2; i < indices.size(); i++)
+					{
+						const size_t t = offsets[f] + i - 2;
+						const size_t corners[] = { 0, i - 1, i };
+
+						glm::vec3 p[3];
+						for (int k = 0; k < 3; k++)
+						{
+							corner_vertices[t * 3 + k] = indices[corners[k]];
+							p[k] = attrib3(*positions, indices[corners[k]]);
+						}
+
+						const glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);	// length is the doubled area
+
+						for (int k = 0; k < 3; k++)
+						{
+							if (weighting == Weighting::Area)
+							{
+								corner_normals[t * 3 + k] = normal;
+								continue;
+							}
+
+							const glm::vec3 a = p[(k + 1) % 3] - p[k];
+							const glm::vec3 b = p[(k + 2) % 3] - p[k];
+							const float lengths = glm::length(a) * glm::length(b);
+							const float area = glm::length(normal);
+
+							corner_normals[t * 3 + k] = lengths > 0.f && area > 0.f ?
+								normal / area * std::acos(std::min(std::max(glm::dot(a, b) / lengths, -1.f), 1.f)) :
+								glm::vec3(0.f);
+						}
+
+						if (!with_tangents || uvs.size() != indices.size())
+							continue;
+
+						float uv[3][2];
+						for (int k = 0; k < 3; k++)
+						{
+							const Float* coordinates = texture->GetPointer() + uvs[corners[k]] * texture->GetDimension();
+							uv[k][0] = coordinates[0];
+							uv[k][1] = coordinates[1];
+						}
+
+						const float du1 = uv[1][0] - uv[0][0], dv1 = uv[1][1] - uv[0][1];
+						const float du2 = uv[2][0] - uv[0][0], dv2 = uv[2][1] - uv[0][1];
+						const float r = du1 * dv2 - du2 * dv1;
+
+						if (r == 0.f)
+							continue;
+
+						triangle_tangents[t] = ((p[1] - p[0]) * dv2 - (p[2] - p[0]) * dv1) / r;
+						triangle_bitangents[t] = ((p[2] - p[0]) * du1 - (p[1] - p[0]) * du2) / r;
+					}
+				}
+			});
+
+		// vertex -> corners by counting sort
+		std::vector<size_t> first(vertices_number + 1);
+		for (auto v : corner_vertices)
+			first[v + 1]++;
+		for (size_t v = 0; v < vertices_number; v++)
+			first[v + 1] += first[v];
+
+		std::vector<size_t> corners(corner_vertices.size());
+		{
+			std::vector<size_t> next(first.begin(), first.end() - 1);
+			for (size_t c = 0; c < corner_vertices.size(); c++)
+				corners[next[corner_vertices[c]]++] = c;
+		}
+
+		auto normals = std::make_shared<AttributeBuffer<Float>>(3);
+		normals->resize(vertices_number * 3);
+
+		auto tangent_buffer = with_tangents ? std::make_shared<AttributeBuffer<Float>>(4) : nullptr;
+		if (tangent_buffer)
+			tangent_buffer->resize(vertices_number * 4);
+
+		// gather: every vertex sums its own corners
+		ParallelFor(vertices_number, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++)
+				{
+					glm::vec3 normal(0.f);
+					for (size_t c = first[v]; c < first[v + 1]; c++)
+						normal += corner_normals[corners[c]];
+
+					const float length = glm::length(normal);
+					if (length > 0.f)
+						normal /= length;
+
+					Float* n = normals->data() + v * 3;
+					n[0] = normal.x;
+					n[1] = normal.y;
+					n[2] = normal.z;
+
+					if (!tangent_buffer)
+						continue;
+
+					glm::vec3 tangent(0.f), bitangent(0.f);
+					for (size_t c = first[v]; c < first[v + 1]; c++)
+					{
+						tangent += triangle_tangents[corners[c] / 3];
+						bitangent += triangle_bitangents[corners[c] / 3];
+					}
+
+					tangent -= normal * glm::dot(normal, tangent);	// Gram-Schmidt
+					const float tangent_length = glm::length(tangent);
+					if (tangent_length > 0.f)
+						tangent /= tangent_length;
+
+					Float* t = tangent_buffer->data() + v * 4;
+					t[0] = tangent.x;
+					t[1] = tangent.y;
+					t[2] = tangent.z;
+					t[3] = glm::dot(glm::cross(normal, tangent), bitangent) < 0.f ? -1.f : 1.f;
+				}
+			});
+
+		// normals and tangents are shared by the corners of the same position, the faces resolve them to the position indices
+		ParallelFor(faces_number, [&](size_t begin, size_t end)
+			{
+				for (size_t f = begin; f < end; f++)
+					std::vector<Uint>().swap((*faces)[f][static_cast<size_t>(Attribute::Normal)]);	// imported indices
+			});
+
+		mesh->SetAttribute(Attribute::Normal, normals);
+		mesh->SetAttribute(Attribute::Tangent, tangent_buffer);
+	}
 }
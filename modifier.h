@@ -1,6 +1,8 @@
 #pragma once
 
 #include "interface.h"
+#include <limits>
+#include <optional>
 #include <glm/glm.hpp>
 
 namespace Converter3D
@@ -18,9 +20,60 @@ namespace Converter3D
 		}
 
 		virtual void Modify(IMesh* mesh) override;
+		virtual const char* GetName() const override { return "Transform"; }
+		virtual std::shared_ptr<IModifier> Fuse(const IModifier& next) const override;
 
 		void Translate(const glm::vec3& v);
 		void Rotate(float angle, const glm::vec3& v);
 		void Scale(const glm::vec3& v);
+
+		const glm::mat4& GetTransform() const { return transform; }
+	};
+
+	// Quadric error metric simplification (Garland-Heckbert). The mesh is triangulated, texture coordinates and normals are dropped.
+	// Cells of a spatial grid are simplified in parallel, vertices of triangles crossing cell borders are locked.
+	// The grid is shifted every pass, so locked areas are processed in the next passes.
+	class SimplifyModifier : public IModifier
+	{
+		size_t target;		// triangles number, 0 - limited by the error only
+		Float max_error;	// max root mean square distance from a collapsed vertex to the planes of its merged triangles
+	public:
+		SimplifyModifier(size_t target, Float max_error = std::numeric_limits<Float>::max()) :
+			target(target),
+			max_error(max_error)
+		{
+		}
+
+		virtual void Modify(IMesh* mesh) override;
+		virtual const char* GetName() const override { return "Simplify"; }
+		virtual std::shared_ptr<IModifier> Fuse(const IModifier& next) const override { return nullptr; }
+	};
+
+	// Smooth vertex normals from the faces and optional tangents from the texture coordinates, indexed like the positions.
+	// Triangles write their corner contributions first, then every vertex gathers its corners, so no locks are needed.
+	class NormalModifier : public IModifier
+	{
+	public:
+		enum class Weighting
+		{
+			Area,
+			Angle,
+		};
+	private:
+		Weighting weighting;
+		bool tangents;
+		std::optional<glm::mat4> transform;	// fused preceding transformation, the old normals are not transformed in vain
+	public:
+		NormalModifier(Weighting weighting = Weighting::Area, bool tangents = false) :
+			weighting(weighting),
+			tangents(tangents)
+		{
+		}
+
+		virtual void Modify(IMesh* mesh) override;
+		virtual const char* GetName() const override { return transform ? "Transform + Normals" : "Normals"; }
+		virtual std::shared_ptr<IModifier> Fuse(const IModifier& next) const override;
+
+		std::shared_ptr<NormalModifier> Prepend(const glm::mat4& matrix) const;
 	};
 }
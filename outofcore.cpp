@@ -0,0 +1,220 @@
+#include "outofcore.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Converter3D
+{
+	PagedFile::PagedFile(size_t page_size, size_t max_pages) :
+		page_size(page_size),
+		max_pages(std::max<size_t>(max_pages, 1))
+	{
+#ifdef _WIN32
+		char directory[MAX_PATH], name[MAX_PATH];
+		if (GetTempPathA(MAX_PATH, directory) && GetTempFileNameA(directory, "c3d", 0, name))
+		{
+			HANDLE handle = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+			if (handle != INVALID_HANDLE_VALUE)
+				file = handle;
+		}
+#else
+		file = tmpfile();	// removed automatically when closed
+#endif
+	}
+
+	PagedFile::~PagedFile()
+	{
+		for (auto& slot : slots)
+			Unmap(slot);
+
+#ifdef _WIN32
+		if (mapping)
+			CloseHandle(mapping);
+		if (file)
+			CloseHandle(file);
+#else
+		if (file)
+			fclose(file);
+#endif
+	}
+
+	bool PagedFile::IsOpen() const
+	{
+		return file != nullptr;
+	}
+
+	bool PagedFile::Grow(size_t size)
+	{
+#ifdef _WIN32
+		// the mapping object cannot grow, existing views keep the old one alive
+		if (mapping)
+			CloseHandle(mapping);
+
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+		if (!mapping)
+			return false;
+#else
+		if (ftruncate(fileno(file), static_cast<off_t>(size)))
+			return false;
+#endif
+		file_size = size;
+		return true;
+	}
+
+	void PagedFile::Unmap(Slot& slot)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(slot.data);
+#else
+		munmap(slot.data, page_size);
+#endif
+		page_slots[slot.page] = 0;
+	}
+
+	char* PagedFile::Page(size_t index)
+	{
+		clock++;
+
+		if (index < page_slots.size() && page_slots[index])
+		{
+			auto& slot = slots[page_slots[index] - 1];
+			slot.used = clock;
+			return slot.data;
+		}
+
+		if (!file)
+			return nullptr;
+
+		if ((index + 1) * page_size > file_size && !Grow(std::max((index + 1) * page_size, file_size + 64 * page_size)))
+			return nullptr;
+
+		if (index >= page_slots.size())
+			page_slots.resize(index + 1);
+
+		size_t number = slots.size();
+		if (number < max_pages)
+			slots.push_back({});
+		else
+		{
+			// evict the least recently used page
+			number = 0;
+			for (size_t i = 1; i < slots.size(); i++)
+				if (slots[i].used < slots[number].used)
+					number = i;
+
+			Unmap(slots[number]);
+		}
+
+		auto& slot = slots[number];
+		const uint64_t offset = static_cast<uint64_t>(index) * page_size;
+
+#ifdef _WIN32
+		void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), page_size);
+#else
+		void* data = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(file), static_cast<off_t>(offset));
+		if (data == MAP_FAILED)
+			data = nullptr;
+#endif
+
+		if (!data)
+		{
+			slots.erase(slots.begin() + number);
+			for (size_t i = number; i < slots.size(); i++)
+				page_slots[slots[i].page] = i + 1;
+			return nullptr;
+		}
+
+		slot = { index, static_cast<char*>(data), clock };
+		page_slots[index] = number + 1;
+		loads++;
+
+		return slot.data;
+	}
+
+	size_t OutOfCoreMesh::PageSize(size_t budget)
+	{
+		// large pages for fewer mappings, but at least several pages in the budget; 64K is the mapping granularity on Windows
+		const size_t Granularity = 64 * 1024;
+		const size_t MaxPageSize = 1024 * 1024;
+
+		return std::min(MaxPageSize, std::max(Granularity, budget / 16 / Granularity * Granularity));
+	}
+
+	OutOfCoreMesh::OutOfCoreMesh(size_t budget) :
+		positions(PageSize(budget), std::max<size_t>(budget / PageSize(budget), 3) - 2),	// triangles are read sequentially, two pages are enough
+		triangles(PageSize(budget), 2)
+	{
+		if (!positions.IsOpen() || !triangles.IsOpen())
+			error = Errors::CannotOpenFile;
+	}
+
+	void OutOfCoreMesh::AddPosition(const glm::vec3& position)
+	{
+		if (error == Errors::Success && !positions.Append(position))
+			error = Errors::CannotOpenFile;
+	}
+
+	void OutOfCoreMesh::AddTriangle(Uint a, Uint b, Uint c)
+	{
+		if (error == Errors::Success && !triangles.Append({ a, b, c }))
+			error = Errors::CannotOpenFile;
+	}
+
+	void OutOfCoreMesh::Transform(const glm::mat4& transform)
+	{
+		if (error == Errors::Success && !positions.ForEachPage([&](glm::vec3* vertices, size_t number)
+			{
+				for (size_t i = 0; i < number; i++)
+					vertices[i] = glm::vec3(transform * glm::vec4(vertices[i], 1.f));
+			}))
+			error = Errors::CannotOpenFile;
+	}
+
+	Float OutOfCoreMesh::Area()
+	{
+		Float area = 0.f;
+		ForEachTriangle([&area](auto a, auto b, auto c) { area += glm::length(glm::cross(c - b, a - b)); });
+		return area / 2.f;
+	}
+
+	Float OutOfCoreMesh::Volume()
+	{
+		Float volume = 0.f;
+		ForEachTriangle([&volume](auto a, auto b, auto c) { volume += glm::dot(a, (glm::cross(b, c))); });
+		return volume / 6.f;
+	}
+
+	void OutOfCoreMesh::ForEachTriangle(const std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)>& func)
+	{
+		if (error != Errors::Success)
+			return;
+
+		const size_t positions_number = positions.GetSize();
+
+		// positions and triangles are different files, looking up positions does not unmap the triangle page
+		if (!triangles.ForEachPage([&](std::array<Uint, 3>* elements, size_t number)
+			{
+				for (size_t t = 0; t < number && error == Errors::Success; t++)
+				{
+					glm::vec3 p[3];
+					for (int i = 0; i < 3; i++)
+					{
+						if (elements[t][i] >= positions_number)
+							error = Errors::WrongMeshFormat;	// index out of range
+						else if (!positions.Get(elements[t][i], p[i]))
+							error = Errors::CannotOpenFile;
+					}
+
+					if (error == Errors::Success)
+						func(p[0], p[1], p[2]);
+				}
+			}))
+			error = Errors::CannotOpenFile;
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "interface.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Converter3D
+{
+	// Temporary file accessed by fixed size memory mapped pages. At most max_pages pages are mapped at once,
+	// the least recently used page is unmapped first. A page pointer is valid until the next Page call of the same file.
+	class PagedFile
+	{
+		struct Slot
+		{
+			size_t page;
+			char* data;
+			uint64_t used;
+		};
+
+		size_t page_size;
+		size_t max_pages;
+		size_t file_size = 0;
+
+		std::vector<Slot> slots;
+		std::vector<size_t> page_slots;	// page -> slot + 1, 0 if not mapped
+		uint64_t clock = 0;
+		size_t loads = 0;
+
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#else
+		FILE* file = nullptr;
+#endif
+
+		bool Grow(size_t size);
+		void Unmap(Slot& slot);
+	public:
+		PagedFile(size_t page_size, size_t max_pages);
+		~PagedFile();
+
+		PagedFile(const PagedFile&) = delete;
+		PagedFile& operator=(const PagedFile&) = delete;
+
+		bool IsOpen() const;
+		char* Page(size_t index);	// nullptr if the page cannot be mapped
+
+		size_t GetPageSize() const { return page_size; }
+		size_t GetLoads() const { return loads; }
+	};
+
+	// Array of trivially copyable elements in a paged file, elements never cross page borders.
+	template<class T>
+	class PagedArray
+	{
+		PagedFile file;
+		const size_t per_page;
+		size_t size = 0;
+	public:
+		PagedArray(size_t page_size, size_t max_pages) :
+			file(page_size, max_pages),
+			per_page(page_size / sizeof(T))
+		{
+		}
+
+		bool IsOpen() const { return file.IsOpen(); }
+
+		bool Append(const T& value)
+		{
+			char* page = file.Page(size / per_page);
+			if (!page)
+				return false;
+
+			reinterpret_cast<T*>(page)[size++ % per_page] = value;
+			return true;
+		}
+
+		bool Get(size_t index, T& value)
+		{
+			char* page = file.Page(index / per_page);
+			if (!page)
+				return false;
+
+			value = reinterpret_cast<const T*>(page)[index % per_page];
+			return true;
+		}
+
+		// sequential pass, the elements can be modified in place
+		bool ForEachPage(const std::function<void(T* elements, size_t number)>& func)
+		{
+			for (size_t first = 0; first < size; first += per_page)
+			{
+				char* page = file.Page(first / per_page);
+				if (!page)
+					return false;
+
+				func(reinterpret_cast<T*>(page), std::min(per_page, size - first));
+			}
+			return true;
+		}
+
+		size_t GetSize() const { return size; }
+		size_t GetLoads() const { return file.GetLoads(); }
+	};
+
+	// Triangle mesh kept in temporary files for meshes larger than RAM, only positions are stored.
+	// All operations are sequential passes over the triangle pages, positions are looked up through the page cache,
+	// so the throughput depends on the locality of the indices and the RAM budget.
+	class OutOfCoreMesh
+	{
+		PagedArray<glm::vec3> positions;
+		PagedArray<std::array<Uint, 3>> triangles;
+
+		Error error = Errors::Success;
+
+		static size_t PageSize(size_t budget);
+	public:
+		OutOfCoreMesh(size_t budget);	// bytes of mapped pages
+
+		void AddPosition(const glm::vec3& position);
+		void AddTriangle(Uint a, Uint b, Uint c);
+
+		size_t GetPositionsNumber() const { return positions.GetSize(); }
+		size_t GetTrianglesNumber() const { return triangles.GetSize(); }
+		size_t GetPageLoads() const { return positions.GetLoads() + triangles.GetLoads(); }
+		Error GetError() const { return error; }
+
+		void Transform(const glm::mat4& transform);
+		Float Area();
+		Float Volume();
+
+		void ForEachTriangle(const std::function<void(const glm::vec3&, const glm::vec3&, const glm::vec3&)>& func);
+	};
+}
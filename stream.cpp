@@ -0,0 +1,385 @@
+#include "stream.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Converter3D
+{
+	FileInputStream::FileInputStream(const char* name)
+	{
+		fopen_s(&stream, name, "rb");
+	}
+
+	FileInputStream::~FileInputStream()
+	{
+		if (stream)
+			fclose(stream);
+	}
+
+	size_t FileInputStream::Read(void* buffer, size_t size)
+	{
+		return stream ? fread(buffer, 1, size, stream) : 0;
+	}
+
+	Error FileInputStream::GetError() const
+	{
+		return !stream || ferror(stream) ? Errors::CannotOpenFile : Errors::Success;
+	}
+
+	MappedInputStream::MappedInputStream(const char* name)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER file_size;
+		if (GetFileSizeEx(file, &file_size) && static_cast<uint64_t>(file_size.QuadPart) <= std::numeric_limits<size_t>::max())
+		{
+			size = static_cast<size_t>(file_size.QuadPart);
+			open = !size;
+
+			if (size && (mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)))
+			{
+				data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				open = data != nullptr;
+			}
+		}
+
+		CloseHandle(file);	// the mapping keeps the file open
+#else
+		const int file = ::open(name, O_RDONLY);
+		if (file < 0)
+			return;
+
+		struct stat status;
+		if (!fstat(file, &status))
+		{
+			size = static_cast<size_t>(status.st_size);
+			open = !size;
+
+			if (size)
+			{
+				void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (view != MAP_FAILED)
+				{
+					madvise(view, size, MADV_SEQUENTIAL);
+					data = static_cast<const char*>(view);
+					open = true;
+				}
+			}
+		}
+
+		close(file);	// the mapping keeps the file open
+#endif
+		if (!open)
+			size = 0;
+	}
+
+	MappedInputStream::~MappedInputStream()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+#else
+		if (data)
+			munmap(const_cast<char*>(data), size);
+#endif
+	}
+
+	size_t MappedInputStream::Read(void* buffer, size_t size)
+	{
+		size = std::min(size, MappedInputStream::size - position);
+		if (size)
+			memcpy(buffer, data + position, size);
+		position += size;
+		return size;
+	}
+
+	Error MappedInputStream::GetError() const
+	{
+		return open ? Errors::Success : Errors::CannotOpenFile;
+	}
+
+	FileOutputStream::FileOutputStream(const char* name)
+	{
+		fopen_s(&stream, name, "wb");	// C i/o is faster
+	}
+
+	FileOutputStream::~FileOutputStream()
+	{
+		if (stream)
+			fclose(stream);
+	}
+
+	size_t FileOutputStream::Write(const void* data, size_t size)
+	{
+		return stream ? fwrite(data, 1, size, stream) : 0;
+	}
+
+	Error FileOutputStream::Finish()
+	{
+		if (!stream)
+			return Errors::CannotOpenFile;
+
+		bool failed = ferror(stream) != 0;
+		failed |= fclose(stream) != 0;
+		stream = nullptr;
+
+		return failed ? Errors::CannotOpenFile : Errors::Success;
+	}
+
+	BlockPipe::BlockPipe(size_t block_size, size_t blocks_number) :
+		blocks(blocks_number)
+	{
+		for (auto& block : blocks)
+		{
+			block.reserve(block_size);
+			free.push_back(&block);
+		}
+	}
+
+	std::vector<char>* BlockPipe::AcquireFree()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return cancelled || !free.empty(); });
+
+		if (cancelled)
+			return nullptr;
+
+		auto block = free.front();
+		free.pop_front();
+		return block;
+	}
+
+	void BlockPipe::PushFilled(std::vector<char>* block)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			filled.push_back(block);
+		}
+		condition.notify_all();
+	}
+
+	std::vector<char>* BlockPipe::AcquireFilled()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this] { return done || !filled.empty(); });
+
+		if (filled.empty())
+			return nullptr;
+
+		auto block = filled.front();
+		filled.pop_front();
+		return block;
+	}
+
+	void BlockPipe::Release(std::vector<char>* block)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			free.push_back(block);
+		}
+		condition.notify_all();
+	}
+
+	void BlockPipe::Done()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = true;
+		}
+		condition.notify_all();
+	}
+
+	void BlockPipe::Cancel()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			cancelled = true;
+		}
+		condition.notify_all();
+	}
+
+	ThreadedInputStream::ThreadedInputStream(std::unique_ptr<IInputStream> source, size_t block_size, size_t blocks_number) :
+		source(std::move(source)),
+		pipe(block_size, blocks_number)
+	{
+		worker = std::thread([this, block_size]
+			{
+				while (auto block = pipe.AcquireFree())
+				{
+					block->resize(block_size);
+					block->resize(ThreadedInputStream::source->Read(block->data(), block_size));
+
+					if (block->empty())
+					{
+						pipe.Release(block);
+						break;
+					}
+
+					pipe.PushFilled(block);
+				}
+
+				pipe.Done();
+			});
+	}
+
+	ThreadedInputStream::~ThreadedInputStream()
+	{
+		pipe.Cancel();
+		worker.join();
+	}
+
+	size_t ThreadedInputStream::Read(void* buffer, size_t size)
+	{
+		size_t total = 0;
+
+		while (total < size)
+		{
+			if (!block)
+			{
+				block = pipe.AcquireFilled();
+				position = 0;
+
+				if (!block)
+					break;	// end of the source stream
+			}
+
+			const size_t number = std::min(size - total, block->size() - position);
+			memcpy(static_cast<char*>(buffer) + total, block->data() + position, number);
+
+			total += number;
+			position += number;
+
+			if (position == block->size())
+			{
+				pipe.Release(block);
+				block = nullptr;
+			}
+		}
+
+		return total;
+	}
+
+	Error ThreadedInputStream::GetError() const
+	{
+		return source->GetError();	// valid once Read returned 0, the worker is idle by then
+	}
+
+	ThreadedOutputStream::ThreadedOutputStream(std::unique_ptr<IOutputStream> sink, size_t block_size, size_t blocks_number) :
+		sink(std::move(sink)),
+		pipe(block_size, blocks_number),
+		block_size(block_size)
+	{
+		worker = std::thread([this]
+			{
+				while (auto block = pipe.AcquireFilled())
+				{
+					ThreadedOutputStream::sink->Write(block->data(), block->size());
+					pipe.Release(block);
+				}
+			});
+	}
+
+	ThreadedOutputStream::~ThreadedOutputStream()
+	{
+		if (worker.joinable())
+		{
+			pipe.Done();
+			worker.join();
+		}
+	}
+
+	size_t ThreadedOutputStream::Write(const void* data, size_t size)
+	{
+		size_t total = 0;
+
+		while (total < size)
+		{
+			if (!block)
+			{
+				block = pipe.AcquireFree();
+				block->clear();
+			}
+
+			const size_t number = std::min(size - total, block_size - block->size());
+			block->insert(block->end(), static_cast<const char*>(data) + total, static_cast<const char*>(data) + total + number);
+
+			total += number;
+
+			if (block->size() == block_size)
+			{
+				pipe.PushFilled(block);
+				block = nullptr;
+			}
+		}
+
+		return total;
+	}
+
+	Error ThreadedOutputStream::Finish()
+	{
+		if (block)
+		{
+			pipe.PushFilled(block);
+			block = nullptr;
+		}
+
+		pipe.Done();
+		worker.join();
+
+		return sink->Finish();
+	}
+
+	char* LineReader::GetLine()
+	{
+		for (;;)
+		{
+			char* first = buffer.data() + begin;
+			char* last = static_cast<char*>(memchr(first, '\n', end - begin));
+
+			if (last || (eof && begin < end))
+			{
+				if (!last)
+					last = buffer.data() + end;	// the last line without line ending
+
+				begin = std::min<size_t>(last - buffer.data() + 1, end);
+
+				if (last > first && last[-1] == '\r')
+					last--;
+				*last = 0;
+
+				return first;
+			}
+
+			if (eof)
+				return nullptr;
+
+			// move the incomplete line to the front, grow the buffer if the line does not fit
+			memmove(buffer.data(), first, end - begin);
+			end -= begin;
+			begin = 0;
+
+			if (end == buffer.size() - 1)
+				buffer.resize(buffer.size() * 2);
+
+			const size_t number = stream->Read(buffer.data() + end, buffer.size() - 1 - end);
+			end += number;
+			eof = !number;
+		}
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "interface.h"
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Converter3D
+{
+	class FileInputStream : public IInputStream
+	{
+		FILE* stream = nullptr;
+	public:
+		FileInputStream(const char* name);
+		~FileInputStream();
+
+		bool IsOpen() const { return stream != nullptr; }
+
+		virtual size_t Read(void* buffer, size_t size) override;
+		virtual Error GetError() const override;
+	};
+
+	// Whole file mapped into memory read-only, parsers can scan it directly instead of reading through a buffer.
+	class MappedInputStream : public IInputStream
+	{
+		const char* data = nullptr;
+		size_t size = 0;
+		size_t position = 0;
+		bool open = false;
+
+#ifdef _WIN32
+		void* mapping = nullptr;
+#endif
+	public:
+		MappedInputStream(const char* name);
+		~MappedInputStream();
+
+		MappedInputStream(const MappedInputStream&) = delete;
+		MappedInputStream& operator=(const MappedInputStream&) = delete;
+
+		bool IsOpen() const { return open; }
+
+		const char* GetData() const { return data; }	// nullptr for an empty file
+		size_t GetSize() const { return size; }
+
+		virtual size_t Read(void* buffer, size_t size) override;
+		virtual Error GetError() const override;
+	};
+
+	class FileOutputStream : public IOutputStream
+	{
+		FILE* stream = nullptr;
+	public:
+		FileOutputStream(const char* name);
+		~FileOutputStream();
+
+		bool IsOpen() const { return stream != nullptr; }
+
+		virtual size_t Write(const void* data, size_t size) override;
+		virtual Error Finish() override;
+	};
+
+	// Fixed set of blocks passed between a producer and a consumer thread.
+	class BlockPipe
+	{
+		std::vector<std::vector<char>> blocks;
+		std::deque<std::vector<char>*> free;
+		std::deque<std::vector<char>*> filled;
+
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		bool done = false;		// producer will not push anymore
+		bool cancelled = false;	// consumer will not pop anymore
+	public:
+		BlockPipe(size_t block_size, size_t blocks_number);
+
+		std::vector<char>* AcquireFree();	// nullptr if cancelled
+		void PushFilled(std::vector<char>* block);
+		std::vector<char>* AcquireFilled();	// nullptr if done and nothing left
+		void Release(std::vector<char>* block);
+
+		void Done();
+		void Cancel();
+	};
+
+	// Reads the source stream in a background thread, so decoding overlaps with parsing.
+	class ThreadedInputStream : public IInputStream
+	{
+		std::unique_ptr<IInputStream> source;
+		BlockPipe pipe;
+		std::thread worker;
+
+		std::vector<char>* block = nullptr;
+		size_t position = 0;
+	public:
+		ThreadedInputStream(std::unique_ptr<IInputStream> source, size_t block_size = 1 << 20, size_t blocks_number = 4);
+		~ThreadedInputStream();
+
+		virtual size_t Read(void* buffer, size_t size) override;
+		virtual Error GetError() const override;
+	};
+
+	// Writes to the sink stream in a background thread, so encoding overlaps with exporting.
+	class ThreadedOutputStream : public IOutputStream
+	{
+		std::unique_ptr<IOutputStream> sink;
+		BlockPipe pipe;
+		std::thread worker;
+
+		std::vector<char>* block = nullptr;
+		const size_t block_size;
+	public:
+		ThreadedOutputStream(std::unique_ptr<IOutputStream> sink, size_t block_size = 1 << 20, size_t blocks_number = 4);
+		~ThreadedOutputStream();
+
+		virtual size_t Write(const void* data, size_t size) override;
+		virtual Error Finish() override;
+	};
+
+	// Splits a stream into null-terminated lines without line endings. Lines can be modified in place.
+	class LineReader
+	{
+		IInputStream* stream;
+		std::vector<char> buffer;
+		size_t begin = 0;
+		size_t end = 0;
+		bool eof = false;
+	public:
+		LineReader(IInputStream* stream, size_t buffer_size = 1 << 20) :
+			stream(stream),
+			buffer(buffer_size + 1)
+		{
+		}
+
+		char* GetLine();	// nullptr at the end of the stream
+	};
+}
@@ -0,0 +1,287 @@
+#include "voxel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace Converter3D
+{
+	namespace
+	{
+		struct Crossing
+		{
+			Uint column;
+			Float depth;	// z in voxels
+		};
+
+		// doubled signed area of (a, b, p), the endpoints are ordered first, so the shared edges of two triangles give exactly opposite values
+		Float Edge(const glm::vec3& a, const glm::vec3& b, Float x, Float y)
+		{
+			if (a.x < b.x || (a.x == b.x && a.y < b.y))
+				return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+			return -((a.x - b.x) * (y - b.y) - (a.y - b.y) * (x - b.x));
+		}
+
+		// exactly one of the two directions of an edge is top-left
+		bool IsTopLeft(const glm::vec3& a, const glm::vec3& b)
+		{
+			return b.y < a.y || (b.y == a.y && b.x < a.x);
+		}
+
+		bool Covers(Float w, const glm::vec3& a, const glm::vec3& b)
+		{
+			return w > 0.f || (w == 0.f && IsTopLeft(a, b));
+		}
+
+		// crossings of the triangle with the columns whose centers it covers, positions are in voxels
+		void Rasterize(glm::vec3 a, glm::vec3 b, glm::vec3 c, const size_t* resolution, std::vector<Crossing>& crossings)
+		{
+			Float area = Edge(a, b, c.x, c.y);
+			if (area == 0.f)
+				return;	// parallel to the columns
+
+			if (area < 0.f)
+			{
+				std::swap(b, c);	// counter-clockwise, the parity does not depend on the orientation
+				area = -area;
+			}
+
+			const Float low[2] = { std::min({ a.x, b.x, c.x }), std::min({ a.y, b.y, c.y }) };
+			const Float high[2] = { std::max({ a.x, b.x, c.x }), std::max({ a.y, b.y, c.y }) };
+
+			// columns with the centers inside the bounding box
+			size_t first[2], last[2];
+			for (int i = 0; i < 2; i++)
+			{
+				const Float begin = std::ceil(low[i] - 0.5f);
+				const Float end = std::floor(high[i] - 0.5f);
+				if (end < 0.f || begin >= static_cast<Float>(resolution[i]) || begin > end)
+					return;
+
+				first[i] = static_cast<size_t>(std::max(begin, 0.f));
+				last[i] = std::min(static_cast<size_t>(end), resolution[i] - 1);
+			}
+
+			for (size_t y = first[1]; y <= last[1]; y++)
+				for (size_t x = first[0]; x <= last[0]; x++)
+				{
+					const Float px = x + 0.5f;
+					const Float py = y + 0.5f;
+
+					const Float wa = Edge(b, c, px, py);
+					const Float wb = Edge(c, a, px, py);
+					const Float wc = Edge(a, b, px, py);
+
+					if (Covers(wa, b, c) && Covers(wb, c, a) && Covers(wc, a, b))
+						crossings.push_back({ static_cast<Uint>(y * resolution[0] + x), (wa * a.z + wb * b.z + wc * c.z) / area });
+				}
+		}
+	}
+
+	VoxelGrid::VoxelGrid(const IMesh& mesh, size_t resolution)
+	{
+		auto& attribute = mesh.GetAttribute(Attribute::Position);
+		auto& faces = mesh.GetFaces();
+
+		glm::vec3 low(std::numeric_limits<Float>::max());
+		glm::vec3 high(-std::numeric_limits<Float>::max());
+
+		Mesh::ForEachTriangle(mesh, [&](auto a, auto b, auto c)
+			{
+				low = glm::min(low, glm::min(a, glm::min(b, c)));
+				high = glm::max(high, glm::max(a, glm::max(b, c)));
+			});
+
+		const glm::vec3 extent = high - low;
+		const Float max_extent = std::max({ extent.x, extent.y, extent.z });
+
+		if (!resolution || !(max_extent > 0.f))
+			return;	// no triangles or no volume
+
+		origin = low;
+		size = max_extent / resolution;
+
+		for (int i = 0; i < 3; i++)
+			VoxelGrid::resolution[i] = std::min(resolution, std::max<size_t>(1, static_cast<size_t>(std::ceil(extent[i] / size))));
+
+		const size_t columns = VoxelGrid::resolution[0] * VoxelGrid::resolution[1];
+		const size_t depth = VoxelGrid::resolution[2];
+
+		// every block of faces is rasterized into its own list
+		const size_t faces_number = faces->GetSize();
+		std::vector<std::vector<Crossing>> blocks(std::min<size_t>(ThreadsNumber() * 4, std::max<size_t>(faces_number, 1)));
+
+		ParallelFor(blocks.size(), [&](size_t first, size_t last)
+			{
+				for (size_t block = first; block < last; block++)
+				{
+					for (size_t f = faces_number * block / blocks.size(); f < faces_number * (block + 1) / blocks.size(); f++)
+					{
+						auto& indices = faces->Get(f).Get(Attribute::Position);
+
+						auto position = [&](size_t i) { return (attrib3(*attribute, indices.Get(i)) - origin) / size; };
+
+						const glm::vec3 a = position(0);
+						for (size_t i = 2; i < indices.GetSize(); i++)
+							Rasterize(a, position(i - 1), position(i), VoxelGrid::resolution, blocks[block]);
+					}
+				}
+			}, 1);
+
+		// counting sort of the crossings by the columns
+		std::vector<Uint> crossing_starts(columns + 1, 0);
+		for (auto& block : blocks)
+			for (auto& crossing : block)
+				crossing_starts[crossing.column + 1]++;
+
+		for (size_t i = 0; i < columns; i++)
+			crossing_starts[i + 1] += crossing_starts[i];
+
+		std::vector<Float> depths(crossing_starts.back());
+		{
+			std::vector<Uint> positions(crossing_starts.begin(), crossing_starts.end() - 1);
+			for (auto& block : blocks)
+			{
+				for (auto& crossing : block)
+					depths[positions[crossing.column]++] = crossing.depth;
+
+				std::vector<Crossing>().swap(block);
+			}
+		}
+
+		// a column has at most half as many runs as crossings, so its runs are put in place of its crossings first
+		std::vector<std::array<Uint, 2>> column_runs(depths.size());
+		std::vector<Uint> counts(columns, 0);
+
+		ParallelFor(columns, [&](size_t first, size_t last)
+			{
+				for (size_t column = first; column < last; column++)
+				{
+					const Uint begin = crossing_starts[column];
+					const Uint end = crossing_starts[column + 1];
+
+					std::sort(depths.begin() + begin, depths.begin() + end);
+
+					// the voxels with the centers between a pair of crossings are inside
+					for (Uint i = begin; i + 1 < end; i += 2)
+					{
+						const Uint enter = static_cast<Uint>(std::min(std::max(std::ceil(depths[i] - 0.5f), 0.f), static_cast<Float>(depth)));
+						const Uint leave = static_cast<Uint>(std::min(std::max(std::ceil(depths[i + 1] - 0.5f), 0.f), static_cast<Float>(depth)));
+
+						if (enter >= leave)
+							continue;
+
+						if (counts[column] && column_runs[begin + counts[column] - 1][1] == enter)
+							column_runs[begin + counts[column] - 1][1] = leave;	// touching runs are merged
+						else
+							column_runs[begin + counts[column]++] = { enter, leave };
+					}
+				}
+			});
+
+		starts.assign(columns + 1, 0);
+		for (size_t i = 0; i < columns; i++)
+			starts[i + 1] = starts[i] + counts[i];
+
+		runs.resize(starts.back());
+
+		ParallelFor(columns, [&](size_t first, size_t last)
+			{
+				for (size_t column = first; column < last; column++)
+					std::copy_n(column_runs.begin() + crossing_starts[column], counts[column], runs.begin() + starts[column]);
+			});
+	}
+
+	size_t VoxelGrid::CountVoxels() const
+	{
+		size_t number = 0;
+		for (auto& run : runs)
+			number += run[1] - run[0];
+		return number;
+	}
+
+	Error VoxelGrid::Write(IOutputStream* stream, bool sparse) const
+	{
+		const size_t BufferSize = 1 << 20;
+
+		std::vector<char> buffer;
+		buffer.reserve(BufferSize);
+
+		auto append = [&buffer](const void* data, size_t size)
+		{
+			buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+		};
+
+		auto flush = [&]()
+		{
+			if (buffer.size() >= BufferSize)
+			{
+				stream->Write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		};
+
+		const uint32_t header[] =
+		{
+			sparse ? 1u : 0u,
+			static_cast<uint32_t>(resolution[0]),
+			static_cast<uint32_t>(resolution[1]),
+			static_cast<uint32_t>(resolution[2]),
+		};
+		const float placement[] = { origin.x, origin.y, origin.z, size };
+
+		append("VOXG", 4);
+		append(header, sizeof(header));
+		append(placement, sizeof(placement));
+
+		const size_t columns = resolution[0] * resolution[1];
+
+		if (sparse)
+		{
+			const uint32_t number = static_cast<uint32_t>(runs.size());
+			append(&number, sizeof(number));
+
+			for (size_t column = 0; column < columns; column++)
+			{
+				for (Uint r = starts[column]; r < starts[column + 1]; r++)
+				{
+					const uint32_t run[] = { static_cast<uint32_t>(column), runs[r][0], runs[r][1] };
+					append(run, sizeof(run));
+				}
+				flush();
+			}
+		}
+		else
+		{
+			const size_t column_size = (resolution[2] + 7) / 8;
+
+			for (size_t column = 0; column < columns; column++)
+			{
+				const size_t offset = buffer.size();
+				buffer.resize(offset + column_size, 0);
+				unsigned char* bits = reinterpret_cast<unsigned char*>(buffer.data() + offset);
+
+				for (Uint r = starts[column]; r < starts[column + 1]; r++)
+				{
+					size_t z = runs[r][0];
+					const size_t end = runs[r][1];
+
+					for (; z < end && z % 8; z++)
+						bits[z / 8] |= 1 << (z % 8);
+
+					const size_t bytes = (end - z) / 8;
+					memset(bits + z / 8, 0xff, bytes);	// whole bytes at once
+					z += bytes * 8;
+
+					for (; z < end; z++)
+						bits[z / 8] |= 1 << (z % 8);
+				}
+				flush();
+			}
+		}
+
+		stream->Write(buffer.data(), buffer.size());
+
+		return stream->Finish();
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "general.h"
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Converter3D
+{
+	// Occupancy of a regular grid of voxels inside a closed mesh.
+	// Every triangle is rasterized once into the crossing lists of the Z columns whose centers it covers,
+	// then the columns are filled in parallel between pairs of sorted crossings (even-odd rule).
+	// Shared edges follow the top-left rule, so a ray through an edge crosses the surface once.
+	class VoxelGrid
+	{
+		glm::vec3 origin;
+		Float size = 0.f;	// edge of a voxel
+		size_t resolution[3] = { 0, 0, 0 };
+
+		std::vector<Uint> starts;				// column -> first run, one more for the end; columns are x-major
+		std::vector<std::array<Uint, 2>> runs;	// occupied voxels [begin, end) along z
+	public:
+		VoxelGrid(const IMesh& mesh, size_t resolution);	// voxels along the longest side of the bounding box
+
+		size_t GetResolution(int axis) const { return resolution[axis]; }
+		size_t CountVoxels() const;
+
+		// Binary little endian file: "VOXG", uint32 sparse flag, uint32 resolution[3], float origin[3], float size, then
+		// dense - every column as ceil(z / 8) bytes with the lowest z in the lowest bit, columns go along x first;
+		// sparse - uint32 runs number, then uint32 column, begin and end of every run.
+		Error Write(IOutputStream* stream, bool sparse) const;
+	};
+}